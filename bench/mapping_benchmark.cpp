@@ -0,0 +1,158 @@
+/*
+ * Benchmark of the linear mappings used by running-length encoding
+ *
+ * For every mapping, reports the time of read (encoding) and write (decoding), the compression ratio
+ * and the miss rates of a simulated L1/L2 cache and TLB for the pixel accesses of readFrame/writeFrame.
+ *
+ * Usage: ./mapping_benchmark [image] [threshold]
+ * Without an image, a synthetic 2000x3000 image is used.
+ */
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <list>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "include/image_compression/running_length_encoding.h"
+#include "include/linear_mapping/hilbert_curve.h"
+#include "include/linear_mapping/morton_curve.h"
+#include "include/linear_mapping/tiled_hilbert_curve.h"
+
+using namespace std;
+
+// set-associative cache with LRU replacement, counting misses of the accessed addresses
+class CacheSimulator
+{
+public:
+    CacheSimulator(size_t capacity, size_t line_size, size_t ways)
+    : line_size(line_size), ways(ways), sets(capacity / line_size / ways, vector<size_t>())
+    {
+
+    }
+    void access(size_t address)
+    {
+        size_t line = address / line_size;
+        vector<size_t>& set = sets[line % sets.size()];
+        accesses++;
+        for (size_t i = 0; i < set.size(); i++)
+        {
+            if (set[i] == line)
+            {
+                // move to most recently used
+                set.erase(set.begin() + i);
+                set.push_back(line);
+                return;
+            }
+        }
+        misses++;
+        if (set.size() == ways)
+            set.erase(set.begin());
+        set.push_back(line);
+    }
+    double missRate() const
+        { return accesses ? (double) misses / accesses : 0.; }
+private:
+    size_t line_size;
+    size_t ways;
+    vector<vector<size_t>> sets;
+    size_t accesses = 0;
+    size_t misses = 0;
+};
+
+cv::Mat syntheticImage(int height, int width)
+{
+    // smooth gradients with flat regions and some noise
+    cv::Mat image(height, width, CV_8UC3);
+    std::default_random_engine rng;
+    std::uniform_int_distribution<int> noise(0, 3);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            uchar* pixel = &image.ptr<uchar>(y)[x * 3];
+            pixel[0] = (uchar) ((x / 16) * 4);
+            pixel[1] = (uchar) ((y / 32) * 8);
+            pixel[2] = (uchar) (((x + y) / 64) * 16 + noise(rng));
+        }
+    }
+    return image;
+}
+
+double seconds(chrono::steady_clock::time_point begin, chrono::steady_clock::time_point end)
+{
+    return chrono::duration<double>(end - begin).count();
+}
+
+int main(int argc, char** argv)
+{
+    cv::Mat image = argc > 1 ? cv::imread(argv[1], cv::IMREAD_COLOR) : syntheticImage(2000, 3000);
+    float threshold = argc > 2 ? atof(argv[2]) : 0.02f;
+    if (image.empty())
+    {
+        cout << "Cannot open image. Please check file location and file format." << endl;
+        return 1;
+    }
+
+    const char* names[] = {"Hilbert curve", "Morton curve", "Tiled Hilbert curve (64)"};
+    stringstream report;
+    report << fixed << setprecision(4);
+    // used by read when the threshold is below one pixel step
+    report << "Run-length kernel: " << runLengthKernelName() << "\n";
+    for (int m = 0; m < 3; m++)
+    {
+        auto newMapping = [m]() -> BaseLinearMapping*
+        {
+            if (m == 0)
+                return new HilbertCurve;
+            if (m == 1)
+                return new MortonCurve;
+            return new TiledHilbertCurve(64);
+        };
+        RunningLengthEncoding encoder(newMapping(), threshold);
+        encoder.setNumThreads(1);
+
+        auto begin = chrono::steady_clock::now();
+        encoder.read(image);
+        auto end = chrono::steady_clock::now();
+        double read_time = seconds(begin, end);
+
+        stringstream encoded;
+        encoder.encode(encoded);
+        size_t num_bytes = encoded.str().size();
+
+        cv::Mat output;
+        begin = chrono::steady_clock::now();
+        encoder.write(output);
+        end = chrono::steady_clock::now();
+        double write_time = seconds(begin, end);
+
+        // replay the pixel accesses of readFrame/writeFrame (one curve traversal per channel)
+        CacheSimulator l1(32 << 10, 64, 8), l2(1 << 20, 64, 16), tlb(64 << 12, 4 << 10, 4);
+        BaseLinearMapping* mapping = newMapping();
+        for (int c = 0; c < image.channels(); c++)
+        {
+            mapping->preprocess(encoder.getPaddedHeight(), encoder.getPaddedWidth());
+            for (cv::Point pt = mapping->next(); pt != POINT_END; pt = mapping->next())
+            {
+                if (pt.y >= image.rows || pt.x >= image.cols)
+                    continue;
+                size_t address = (size_t) (&locPixel(image, pt, c) - image.ptr<uchar>(0));
+                tlb.access(address);
+                l1.access(address);
+                l2.access(address);
+            }
+        }
+        delete mapping;
+
+        report << names[m] << "\n"
+            << "\tpadded size: " << encoder.getPaddedHeight() << " x " << encoder.getPaddedWidth() << "\n"
+            << "\tread: " << read_time << "s, write: " << write_time << "s\n"
+            << "\tcompressed bytes: " << num_bytes
+            << ", compression ratio: " << (double) image.total() * image.channels() / num_bytes << "\n"
+            << "\tsimulated miss rate: L1 " << l1.missRate() << ", L2 " << l2.missRate()
+            << ", TLB " << tlb.missRate() << "\n";
+    }
+    cout << " -------------------- Benchmark results -------------------- \n" << report.str();
+    return 0;
+}
@@ -1,5 +1,6 @@
 
 #include "include/image_compression/base_compression.h"
+#include <climits>
 
 const std::size_t BaseImageCompression::_METADATA_SIZE = 128;
 
@@ -12,72 +13,45 @@ BaseImageCompression::BaseImageCompression(bool padding)
 void BaseImageCompression::read(cv::Mat& image)
 {
     // accept an image with CV_8U or CV_8UC? for now
-    std::cout << " -------------------- Read image begins -------------------- \n";
+    assert(image.depth() == CV_8U);
+    if (_verbose)
+        std::cout << " -------------------- Read image begins -------------------- \n";
     Timer timer;
     timer.begin();
     _num_channels = image.channels();
     _height = image.rows;
     _width = image.cols;
 
-    cv::Mat frames[MAX_NUM_CHANNELS];
-    if (getNumChannels() > 1)
-    {
-        cv::split(image, frames);
-    }
-    else
-    {
-        frames[0] = image.clone();
-    }
-
-    for (int i = 0; i < getNumChannels(); i++)
+    // channels are read straight from the interleaved image, padding is handled by readFrame
+    for (std::size_t i = 0; i < getNumChannels(); i++)
+        readFrame(image, i);
+    timer.end();
+    if (_verbose)
     {
-        // internally use CV_32F
-        frames[i].convertTo(frames[i], CV_32F, 1./255., 0.);
-        if (_padding)
-            addPadding(frames[i], frames[i], _padded_height, _padded_width);
-        readFrame(frames[i], i);
+        timer.report();
+        std::cout << " -------------------- Read image ends -------------------- \n";
     }
-    timer.end();
-    timer.report();
-    std::cout << " -------------------- Read image ends -------------------- \n";
 }
 
 void BaseImageCompression::write(cv::Mat& image, bool show_padding)
 {
-    std::cout << " -------------------- Write image begins -------------------- \n";
+    if (_verbose)
+        std::cout << " -------------------- Write image begins -------------------- \n";
     Timer timer;
     timer.begin();
-    cv::Mat frames[MAX_NUM_CHANNELS];
-    if (show_padding)
-    {
-        for (int i = 0; i < getNumChannels(); i++)
-        {
-            frames[i] = cv::Mat::zeros(cv::Size{(int)getPaddedWidth(), (int)getPaddedHeight()}, CV_32F);
-            writeFrame(frames[i], i);
-            frames[i].convertTo(frames[i], CV_8U, 255., 0.);
-        }
-    }
-    else
-    {
-        for (int i = 0; i < getNumChannels(); i++)
-        {
-            frames[i] = cv::Mat::zeros(cv::Size{(int)_width, (int)_height}, CV_32F);
-            writeFrame(frames[i], i);
-            frames[i].convertTo(frames[i], CV_8U, 255., 0.);
-        }
-    }
-    
-    if (getNumChannels() > 1)
-    {
-        cv::merge(frames, getNumChannels(), image);
-    }
-    else
+    cv::Size size = show_padding
+        ? cv::Size{(int)getPaddedWidth(), (int)getPaddedHeight()}
+        : cv::Size{(int)_width, (int)_height};
+    // channels are written straight into the interleaved output image
+    image = cv::Mat::zeros(size, CV_8UC((int)getNumChannels()));
+    for (std::size_t i = 0; i < getNumChannels(); i++)
+        writeFrame(image, i);
+    timer.end();
+    if (_verbose)
     {
-        image = frames[0];
+        timer.report();
+        std::cout << " -------------------- Write image ends -------------------- \n";
     }
-    timer.end();
-    timer.report();
-    std::cout << " -------------------- Write image ends -------------------- \n";
 }
 
 void BaseImageCompression::info() const
@@ -101,6 +75,11 @@ void BaseImageCompression::info() const
         std::cout << "\t\tframe " << i << ": " << getNumBytes(i) << "\n";
         total_bytes += getNumBytes(i);
     }
+    if (getAuxiliaryBytes())
+    {
+        std::cout << "\t\tauxiliary: " << getAuxiliaryBytes() << "\n";
+        total_bytes += getAuxiliaryBytes();
+    }
     std::cout << "\tTotal: " << total_bytes << "\n";
     std::cout << "\tCompression ratio: " << (long double) total_resolution / total_bytes << "\n";
     std::cout << " -------------------- Info ends -------------------- \n";
@@ -109,9 +88,14 @@ void BaseImageCompression::info() const
 void BaseImageCompression::encode(std::ostream& file)
 {
     assert(loaded());
-    std::cout << " -------------------- Encode image begins -------------------- \n";
+    if (_verbose)
+        std::cout << " -------------------- Encode image begins -------------------- \n";
     Timer timer;
     timer.begin();
+    std::size_t total_bytes = _METADATA_SIZE + getAuxiliaryBytes();
+    for (std::size_t i = 0; i < getNumChannels(); i++)
+        total_bytes += getNumBytes(i);
+    uchar* buffer = reserveBuffer(total_bytes);
     //
     // Write metadata (preserve 128B, 8B to store each var):
     //  (unsigned long) num_channels
@@ -121,42 +105,152 @@ void BaseImageCompression::encode(std::ostream& file)
     //  (unsigned long) padded_height
     //  (unsigned long) padded_width
     //  (unsigned long []) num_bytes (@per frame) [warning: variable length]
+    //  (unsigned long) auxiliary_bytes (after num_bytes of MAX_NUM_CHANNELS frames)
     //
-    std::memset(compression_buffer, 0, _METADATA_SIZE);
-    locDWord(compression_buffer, (0 << 3)) = getNumChannels();
-    // std::cout << (void*) &compression_buffer << " " << (void*) &locDWord(compression_buffer, (0 << 3)) << std::endl;
-    locDWord(compression_buffer, (1 << 3)) = getHeight();
-    locDWord(compression_buffer, (2 << 3)) = getWidth();
-    locDWord(compression_buffer, (3 << 3)) = (std::size_t) _padding;
-    locDWord(compression_buffer, (4 << 3)) = getPaddedHeight();
-    locDWord(compression_buffer, (5 << 3)) = getPaddedWidth();
-    std::size_t total_bytes = _METADATA_SIZE;
+    std::memset(buffer, 0, _METADATA_SIZE);
+    locDWord(buffer, (0 << 3)) = getNumChannels();
+    locDWord(buffer, (1 << 3)) = getHeight();
+    locDWord(buffer, (2 << 3)) = getWidth();
+    locDWord(buffer, (3 << 3)) = (std::size_t) _padding;
+    locDWord(buffer, (4 << 3)) = getPaddedHeight();
+    locDWord(buffer, (5 << 3)) = getPaddedWidth();
     for (std::size_t i = 0; i < getNumChannels(); i++)
     {
         // std::cout << "setting bytes " << i << " " << getNumBytes(i) << "\n";
-        locDWord(compression_buffer, ((i + 6) << 3)) = getNumBytes(i);
-        total_bytes += getNumBytes(i);
+        locDWord(buffer, ((i + 6) << 3)) = getNumBytes(i);
     }
-    assert(total_bytes <= BUFFER_SIZE);
+    locDWord(buffer, ((MAX_NUM_CHANNELS + 6) << 3)) = getAuxiliaryBytes();
     std::size_t write_pos = _METADATA_SIZE;
     for (std::size_t i = 0; i < getNumChannels(); i++)
     {
-        // std::cout << (void*) &compression_buffer << std::endl;
-        encodeFrame(&compression_buffer[0], i, write_pos, write_pos + getNumBytes(i));
+        encodeFrame(buffer, i, write_pos, write_pos + getNumBytes(i));
         write_pos += getNumBytes(i);
     }
-    file.write((char*) compression_buffer, write_pos);
+    // auxiliary section follows the frames
+    if (getAuxiliaryBytes())
+    {
+        encodeAuxiliary(buffer, write_pos, write_pos + getAuxiliaryBytes());
+        write_pos += getAuxiliaryBytes();
+    }
+    assert(write_pos == total_bytes);
+    file.write((char*) buffer, write_pos);
     timer.end();
-    timer.report();
-    std::cout << " -------------------- Encode image ends -------------------- \n";
+    if (_verbose)
+    {
+        timer.report();
+        std::cout << " -------------------- Encode image ends -------------------- \n";
+    }
 }
 
-void BaseImageCompression::decode(std::istream& file)
+bool BaseImageCompression::decode(std::istream& file)
 {
-    std::cout << " -------------------- Decode image begins -------------------- \n";
+    if (_verbose)
+        std::cout << " -------------------- Decode image begins -------------------- \n";
     Timer timer;
     timer.begin();
-    file.read((char*) compression_buffer, BUFFER_SIZE);
+    // read metadata first, then exactly the rest of the compressed image
+    std::size_t remaining_bytes = remainingBytes(file);
+    uchar* buffer = reserveBuffer(_METADATA_SIZE);
+    file.read((char*) buffer, _METADATA_SIZE);
+    std::size_t auxiliary_bytes = 0;
+    std::size_t frame_bytes = 0;
+    bool valid = (std::size_t) file.gcount() == _METADATA_SIZE
+        && decodeMetadata(buffer, auxiliary_bytes)
+        && checkPaddedSize()
+        && checkPayloadBytes(auxiliary_bytes, remaining_bytes, frame_bytes);
+    if (valid)
+    {
+        buffer = reserveBuffer(_METADATA_SIZE + frame_bytes + auxiliary_bytes);
+        file.read((char*) &buffer[_METADATA_SIZE], frame_bytes + auxiliary_bytes);
+        valid = (std::size_t) file.gcount() == frame_bytes + auxiliary_bytes;
+    }
+    std::size_t write_pos = _METADATA_SIZE;
+    for (std::size_t i = 0; valid && i < getNumChannels(); i++)
+    {
+        valid = decodeFrame(buffer, i, write_pos, write_pos + getNumBytes(i));
+        write_pos += getNumBytes(i);
+    }
+    if (valid && auxiliary_bytes)
+        valid = decodeAuxiliary(buffer, write_pos, write_pos + auxiliary_bytes);
+    timer.end();
+    if (!valid)
+        _num_channels = 0;
+    if (_verbose)
+    {
+        timer.report();
+        if (!valid)
+            std::cout << "\tThe compressed image is truncated or corrupt.\n";
+        std::cout << " -------------------- Decode image ends -------------------- \n";
+    }
+    return valid;
+}
+
+bool BaseImageCompression::decodeAuxiliarySection(std::istream& file)
+{
+    // read metadata only and skip the frames
+    std::size_t remaining_bytes = remainingBytes(file);
+    uchar* buffer = reserveBuffer(_METADATA_SIZE);
+    file.read((char*) buffer, _METADATA_SIZE);
+    std::size_t auxiliary_bytes = 0;
+    std::size_t frame_bytes = 0;
+    if ((std::size_t) file.gcount() != _METADATA_SIZE
+        || !decodeMetadata(buffer, auxiliary_bytes)
+        || !checkPayloadBytes(auxiliary_bytes, remaining_bytes, frame_bytes))
+    {
+        _num_channels = 0;
+        return false;
+    }
+    if (auxiliary_bytes == 0)
+        return true;
+    buffer = reserveBuffer(_METADATA_SIZE + auxiliary_bytes);
+    file.seekg(frame_bytes, std::ios::cur);
+    file.read((char*) &buffer[_METADATA_SIZE], auxiliary_bytes);
+    if ((std::size_t) file.gcount() != auxiliary_bytes
+        || !decodeAuxiliary(buffer, _METADATA_SIZE, _METADATA_SIZE + auxiliary_bytes))
+    {
+        _num_channels = 0;
+        return false;
+    }
+    return true;
+}
+
+uchar* BaseImageCompression::reserveBuffer(std::size_t num_bytes)
+{
+    // the buffer only grows, so it stays allocated between images
+    if (_buffer.size() < num_bytes)
+        _buffer.resize(num_bytes);
+    return _buffer.data();
+}
+
+std::size_t BaseImageCompression::remainingBytes(std::istream& file)
+{
+    std::streampos begin = file.tellg();
+    if (begin == std::streampos(-1))
+        return SIZE_MAX;
+    file.seekg(0, std::ios::end);
+    std::streampos end = file.tellg();
+    file.seekg(begin);
+    return end > begin ? (std::size_t) (end - begin) : 0;
+}
+
+bool BaseImageCompression::checkPayloadBytes(
+    std::size_t auxiliary_bytes, std::size_t remaining_bytes, std::size_t& frame_bytes
+) const
+{
+    // sizes are compared one at a time, so corrupt sizes cannot overflow the sum
+    remaining_bytes -= std::min(remaining_bytes, _METADATA_SIZE);
+    frame_bytes = 0;
+    for (std::size_t i = 0; i < getNumChannels(); i++)
+    {
+        if (getNumBytes(i) > remaining_bytes - frame_bytes)
+            return false;
+        frame_bytes += getNumBytes(i);
+    }
+    return auxiliary_bytes <= remaining_bytes - frame_bytes;
+}
+
+bool BaseImageCompression::decodeMetadata(uchar* buffer, std::size_t& auxiliary_bytes)
+{
     //
     // Read metadata
     //  (unsigned long) num_channels
@@ -166,43 +260,40 @@ void BaseImageCompression::decode(std::istream& file)
     //  (unsigned long) padded_height
     //  (unsigned long) padded_width
     //  (unsigned long []) num_bytes (@per frame) [warning: variable length]
+    //  (unsigned long) auxiliary_bytes (after num_bytes of MAX_NUM_CHANNELS frames)
     //
-    _num_channels = locDWord(compression_buffer, (0 << 3));
-    _height = locDWord(compression_buffer, (1 << 3));
-    _width = locDWord(compression_buffer, (2 << 3));
-    _padding = locDWord(compression_buffer, (3 << 3));
-    _padded_height = locDWord(compression_buffer, (4 << 3));
-    _padded_width = locDWord(compression_buffer, (5 << 3));
-    std::size_t total_bytes = _METADATA_SIZE;
+    _num_channels = locDWord(buffer, (0 << 3));
+    _height = locDWord(buffer, (1 << 3));
+    _width = locDWord(buffer, (2 << 3));
+    _padding = locDWord(buffer, (3 << 3));
+    _padded_height = locDWord(buffer, (4 << 3));
+    _padded_width = locDWord(buffer, (5 << 3));
+    if (getNumChannels() == 0 || getNumChannels() > MAX_NUM_CHANNELS)
+        return false;
+    // images are cv::Mat objects, so every dimension must fit in an int
+    if (getHeight() > getPaddedHeight() || getWidth() > getPaddedWidth()
+        || getPaddedHeight() > INT_MAX || getPaddedWidth() > INT_MAX
+        || getPaddedHeight() * getPaddedWidth() > SIZE_MAX / MAX_NUM_CHANNELS)
+        return false;
     for (std::size_t i = 0; i < getNumChannels(); i++)
     {
-        // std::cout << "setting bytes " << i << " " << locDWord(compression_buffer, i+6) << "\n";
-        setNumBytes(i, locDWord(compression_buffer, ((i + 6) << 3)));
-        total_bytes += getNumBytes(i);
+        // std::cout << "setting bytes " << i << " " << locDWord(buffer, i+6) << "\n";
+        setNumBytes(i, locDWord(buffer, ((i + 6) << 3)));
     }
-    assert(total_bytes <= BUFFER_SIZE);
-    std::size_t write_pos = _METADATA_SIZE;
-    for (std::size_t i = 0; i < getNumChannels(); i++)
-    {
-        decodeFrame(compression_buffer, i, write_pos, write_pos + getNumBytes(i));
-        write_pos += getNumBytes(i);
-    }
-    timer.end();
-    timer.report();
-    std::cout << " -------------------- Decode image ends -------------------- \n";
+    // files written before the auxiliary section existed have zeros here
+    auxiliary_bytes = locDWord(buffer, ((MAX_NUM_CHANNELS + 6) << 3));
+    return true;
+}
+
+void BaseImageCompression::setPaddedSize(const BaseLinearMapping& mapping, std::size_t height, std::size_t width)
+{
+    cv::Size padded_size = mapping.getPaddedSize(height, width);
+    setPaddedHeight(padded_size.height);
+    setPaddedWidth(padded_size.width);
 }
 
-void addPadding(cv::Mat& input_img, cv::Mat& output_img, std::size_t padded_height, std::size_t padded_width)
+bool BaseImageCompression::matchesPaddedSize(const BaseLinearMapping& mapping) const
 {
-    // std::cout << padded_height << " " << input_img.rows << " " << padded_width << " " << input_img.cols << std::endl;
-    assert((padded_height >= input_img.rows) && (padded_width >= input_img.cols));
-    cv::copyMakeBorder(
-        input_img, output_img,
-        0,
-        padded_height - input_img.rows,
-        0,
-        padded_width - input_img.cols,
-        CV_HAL_BORDER_CONSTANT,
-        cv::Scalar(-1.)
-    );
+    cv::Size padded_size = mapping.getPaddedSize(getHeight(), getWidth());
+    return (std::size_t) padded_size.height == getPaddedHeight() && (std::size_t) padded_size.width == getPaddedWidth();
 }
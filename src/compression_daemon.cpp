@@ -0,0 +1,374 @@
+#include "include/compression_daemon.h"
+#include <algorithm>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "include/image_compression/running_length_encoding.h"
+#include "include/image_compression/predictive_encoding.h"
+#include "include/image_compression/joint_running_length_encoding.h"
+#include "include/linear_mapping/hilbert_curve.h"
+#include "include/linear_mapping/morton_curve.h"
+#include "include/linear_mapping/tiled_hilbert_curve.h"
+
+// read exactly num_bytes bytes, returns false if the connection is closed
+static bool readBytes(int connection, char* data, std::size_t num_bytes)
+{
+    while (num_bytes > 0)
+    {
+        ssize_t received = ::read(connection, data, num_bytes);
+        if (received <= 0)
+            return false;
+        data += received;
+        num_bytes -= received;
+    }
+    return true;
+}
+
+static bool writeBytes(int connection, const char* data, std::size_t num_bytes)
+{
+    while (num_bytes > 0)
+    {
+        ssize_t sent = ::write(connection, data, num_bytes);
+        if (sent <= 0)
+            return false;
+        data += sent;
+        num_bytes -= sent;
+    }
+    return true;
+}
+
+// the longest accepted request header, paths included
+static const std::size_t MAX_LINE_LENGTH = 4096;
+
+// read a line without its '\n', returns false if the connection is closed or the line is longer than max_length
+static bool readLine(int connection, std::string& line, std::size_t max_length)
+{
+    line.clear();
+    char c;
+    while (readBytes(connection, &c, 1))
+    {
+        if (c == '\n')
+            return true;
+        line.push_back(c);
+        if (line.size() > max_length)
+            return false;
+    }
+    return false;
+}
+
+static bool writeLine(int connection, const std::string& line)
+{
+    return writeBytes(connection, line.data(), line.size()) && writeBytes(connection, "\n", 1);
+}
+
+// set by SIGINT/SIGTERM, makes run stop accepting connections
+static volatile std::sig_atomic_t stop_requested = 0;
+
+static void requestStop(int)
+{
+    stop_requested = 1;
+}
+
+static BaseLinearMapping* newLinearMapping(int mapping)
+{
+    switch (mapping)
+    {
+    case 0:
+        return new HilbertCurve;
+    case 1:
+        return new MortonCurve;
+    case 2:
+        return new TiledHilbertCurve(64);
+    default:
+        return nullptr;
+    }
+}
+
+CompressionDaemon::CompressionDaemon(const std::string& socket_path, std::size_t num_workers, std::size_t max_request_bytes)
+: _socket_path(socket_path), _num_workers(std::max<std::size_t>(num_workers, 1)), _max_request_bytes(max_request_bytes)
+{
+
+}
+
+bool CompressionDaemon::run()
+{
+    // a client hanging up must not terminate the daemon
+    std::signal(SIGPIPE, SIG_IGN);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (_socket_path.size() >= sizeof(address.sun_path))
+    {
+        std::cout << "Socket path is too long." << std::endl;
+        return false;
+    }
+    std::strncpy(address.sun_path, _socket_path.c_str(), sizeof(address.sun_path) - 1);
+    // only a stale socket may be replaced, never a regular file given by mistake
+    struct stat status;
+    if (::lstat(_socket_path.c_str(), &status) == 0)
+    {
+        if (!S_ISSOCK(status.st_mode))
+        {
+            std::cout << "Cannot listen on " << _socket_path << ", the file exists and is not a socket." << std::endl;
+            return false;
+        }
+        ::unlink(_socket_path.c_str());
+    }
+    int server = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0 || ::bind(server, (sockaddr*) &address, sizeof(address)) < 0 || ::listen(server, SOMAXCONN) < 0)
+    {
+        std::cout << "Cannot listen on " << _socket_path << "." << std::endl;
+        if (server >= 0)
+            ::close(server);
+        return false;
+    }
+    std::cout << "Listening on " << _socket_path << " with " << _num_workers << " workers" << std::endl;
+
+    // no SA_RESTART, so a signal interrupts accept
+    struct sigaction stop_action = {};
+    stop_action.sa_handler = requestStop;
+    sigemptyset(&stop_action.sa_mask);
+    ::sigaction(SIGINT, &stop_action, nullptr);
+    ::sigaction(SIGTERM, &stop_action, nullptr);
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < _num_workers; i++)
+        workers.emplace_back(&CompressionDaemon::work, this);
+    bool accepting = true;
+    while (accepting && !stop_requested)
+    {
+        int connection = ::accept(server, nullptr, nullptr);
+        if (connection < 0)
+        {
+            accepting = errno == EINTR || errno == ECONNABORTED;
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(_connections_mutex);
+        _connections.push(connection);
+        _connections_available.notify_one();
+    }
+    if (!accepting)
+        std::cout << "Cannot accept connections on " << _socket_path << "." << std::endl;
+
+    ::close(server);
+    ::unlink(_socket_path.c_str());
+    {
+        // wake up the workers and make their blocking reads return
+        std::lock_guard<std::mutex> lock(_connections_mutex);
+        _stopping = true;
+        for (; !_connections.empty(); _connections.pop())
+            ::close(_connections.front());
+        for (int connection : _active_connections)
+            ::shutdown(connection, SHUT_RDWR);
+        _connections_available.notify_all();
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+    return accepting;
+}
+
+void CompressionDaemon::work()
+{
+    // compressors are private to the worker and reused by all its connections
+    _CompressorCache cache;
+    while (true)
+    {
+        int connection;
+        {
+            std::unique_lock<std::mutex> lock(_connections_mutex);
+            _connections_available.wait(lock, [this] { return _stopping || !_connections.empty(); });
+            if (_stopping)
+                return;
+            connection = _connections.front();
+            _connections.pop();
+            _active_connections.insert(connection);
+        }
+        serveConnection(connection, cache);
+        {
+            std::lock_guard<std::mutex> lock(_connections_mutex);
+            _active_connections.erase(connection);
+        }
+        ::close(connection);
+    }
+}
+
+void CompressionDaemon::serveConnection(int connection, _CompressorCache& cache)
+{
+    std::string request;
+    while (readLine(connection, request, MAX_LINE_LENGTH))
+    {
+        try
+        {
+            if (!serveRequest(connection, request, cache))
+                return;
+        }
+        catch (const std::exception& e)
+        {
+            // e.g. std::bad_alloc or cv::Exception, the compressors may be half-updated and the payload half-read
+            cache.clear();
+            std::string reason = e.what();
+            std::replace(reason.begin(), reason.end(), '\n', ' ');
+            writeLine(connection, "ERROR " + reason);
+            return;
+        }
+    }
+    if (request.size() > MAX_LINE_LENGTH)
+        writeLine(connection, "ERROR request too long");
+}
+
+bool CompressionDaemon::withinRequestLimit(std::size_t height, std::size_t width, std::size_t num_channels) const
+{
+    // compared by division, so huge dimensions cannot overflow
+    return num_channels > 0 && width > 0
+        && height <= _max_request_bytes / num_channels / width;
+}
+
+BaseImageCompression* CompressionDaemon::getCompressor(int algorithm, int mapping, double parameter, _CompressorCache& cache)
+{
+    int predictor = algorithm == 1 ? (int) parameter : 0;
+    std::string key = std::to_string(algorithm) + " " + std::to_string(mapping) + " " + std::to_string(predictor);
+    std::unique_ptr<BaseImageCompression>& compressor = cache[key];
+    if (!compressor)
+    {
+        BaseLinearMapping* linear_mapping = newLinearMapping(mapping);
+        if (linear_mapping == nullptr)
+            return nullptr;
+        switch (algorithm)
+        {
+        case 0:
+        {
+            RunningLengthEncoding* encoder = new RunningLengthEncoding(linear_mapping, parameter);
+            // workers already run in parallel
+            encoder->setNumThreads(1);
+            compressor.reset(encoder);
+            break;
+        }
+        case 1:
+            if (predictor != PredictiveEncoding::PREVIOUS && predictor != PredictiveEncoding::LINEAR)
+            {
+                delete linear_mapping;
+                return nullptr;
+            }
+            compressor.reset(new PredictiveEncoding(linear_mapping, (PredictiveEncoding::Predictor) predictor));
+            break;
+        case 2:
+            compressor.reset(new JointRunningLengthEncoding(linear_mapping, parameter));
+            break;
+        default:
+            delete linear_mapping;
+            return nullptr;
+        }
+        // workers share std::cout, per-request banners would only interleave
+        compressor->setVerbose(false);
+    }
+    if (algorithm == 0)
+        dynamic_cast<RunningLengthEncoding*>(compressor.get())->setThreshold(parameter);
+    else if (algorithm == 2)
+        dynamic_cast<JointRunningLengthEncoding*>(compressor.get())->setThreshold(parameter);
+    return compressor.get();
+}
+
+bool CompressionDaemon::serveRequest(int connection, const std::string& request, _CompressorCache& cache)
+{
+    std::istringstream header(request);
+    std::string command;
+    int algorithm, mapping;
+    double parameter;
+    header >> command >> algorithm >> mapping >> parameter;
+    // the payload of a rejected raw request is not read, so the connection cannot be resynchronised
+    const bool raw = command == "ENCODE_RAW" || command == "DECODE_RAW";
+    auto reject = [&](const std::string& reason)
+        { return writeLine(connection, "ERROR " + reason) && !raw; };
+    if (header.fail())
+        return reject("invalid request");
+
+    if (command == "ENCODE" || command == "DECODE")
+    {
+        std::string input_path, output_path;
+        header >> input_path >> output_path;
+        if (header.fail())
+            return reject("invalid request");
+        BaseImageCompression* compressor = getCompressor(algorithm, mapping, parameter, cache);
+        if (compressor == nullptr)
+            return reject("invalid codec parameters");
+        if (command == "ENCODE")
+        {
+            cv::Mat image = cv::imread(input_path, cv::IMREAD_COLOR);
+            if (image.empty())
+                return reject("cannot open image");
+            std::ofstream encoded_file(output_path, std::ios::out | std::ios::binary);
+            if (!encoded_file.is_open())
+                return reject("cannot open output file");
+            compressor->read(image);
+            compressor->encode(encoded_file);
+        }
+        else
+        {
+            std::ifstream encoded_file(input_path, std::ios::in | std::ios::binary);
+            if (!encoded_file.is_open())
+                return reject("cannot open file");
+            if (!compressor->decode(encoded_file))
+                return reject("corrupt compressed image");
+            if (!withinRequestLimit(compressor->getPaddedHeight(), compressor->getPaddedWidth(), compressor->getNumChannels()))
+                return reject("image too large");
+            cv::Mat image;
+            compressor->write(image, false);
+            if (!cv::imwrite(output_path, image))
+                return reject("cannot write image");
+        }
+        return writeLine(connection, "OK");
+    }
+    else if (command == "ENCODE_RAW")
+    {
+        int height, width, num_channels;
+        header >> height >> width >> num_channels;
+        if (header.fail() || height <= 0 || width <= 0 || num_channels <= 0 || num_channels > (int) MAX_NUM_CHANNELS)
+            return reject("invalid request");
+        if (!withinRequestLimit(height, width, num_channels))
+            return reject("request too large");
+        BaseImageCompression* compressor = getCompressor(algorithm, mapping, parameter, cache);
+        if (compressor == nullptr)
+            return reject("invalid codec parameters");
+        cv::Mat image(height, width, CV_8UC(num_channels));
+        if (!readBytes(connection, (char*) image.ptr<uchar>(0), image.total() * image.elemSize()))
+            return false;
+        compressor->read(image);
+        std::ostringstream encoded;
+        compressor->encode(encoded);
+        const std::string& encoded_bytes = encoded.str();
+        return writeLine(connection, "OK " + std::to_string(encoded_bytes.size()))
+            && writeBytes(connection, encoded_bytes.data(), encoded_bytes.size());
+    }
+    else if (command == "DECODE_RAW")
+    {
+        std::size_t num_bytes;
+        header >> num_bytes;
+        if (header.fail())
+            return reject("invalid request");
+        if (num_bytes > _max_request_bytes)
+            return reject("request too large");
+        BaseImageCompression* compressor = getCompressor(algorithm, mapping, parameter, cache);
+        if (compressor == nullptr)
+            return reject("invalid codec parameters");
+        std::string encoded_bytes(num_bytes, '\0');
+        if (!readBytes(connection, &encoded_bytes[0], num_bytes))
+            return false;
+        // from here on the payload has been read, so failures keep the connection open
+        std::istringstream encoded(encoded_bytes);
+        if (!compressor->decode(encoded))
+            return writeLine(connection, "ERROR corrupt compressed image");
+        if (!withinRequestLimit(compressor->getPaddedHeight(), compressor->getPaddedWidth(), compressor->getNumChannels()))
+            return writeLine(connection, "ERROR image too large");
+        cv::Mat image;
+        compressor->write(image, false);
+        return writeLine(connection,
+                "OK " + std::to_string(image.rows) + " " + std::to_string(image.cols) + " " + std::to_string(image.channels()))
+            && writeBytes(connection, (const char*) image.ptr<uchar>(0), image.total() * image.elemSize());
+    }
+    return reject("unknown command");
+}
@@ -0,0 +1,76 @@
+#ifndef COMPRESSION_DAEMON
+#define COMPRESSION_DAEMON
+#include <iostream>
+#include <string>
+#include <map>
+#include <memory>
+#include <queue>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+#include <opencv2/opencv.hpp>
+#include "include/image_compression/base_compression.h"
+
+// default bound on the payload and image sizes of a single request
+const std::size_t DEFAULT_MAX_REQUEST_BYTES = (std::size_t) 1 << 30;
+
+/*
+ * Long-running compression service listening on a Unix domain socket
+ *
+ * Connections are served by a pool of workers. Every worker keeps its compressors alive between requests,
+ * so curve tables and compression buffers stay warm. A connection may send any number of requests,
+ * each made of a header line and an optional binary payload:
+ *
+ *  - ENCODE <algorithm> <mapping> <parameter> <input path> <output path>
+ *      compress an image file into a compressed file, replies "OK"
+ *  - DECODE <algorithm> <mapping> <parameter> <input path> <output path>
+ *      decompress a compressed file into an image file, replies "OK"
+ *  - ENCODE_RAW <algorithm> <mapping> <parameter> <height> <width> <num channels>, followed by the pixels
+ *      compress interleaved 8-bit pixels, replies "OK <num bytes>" followed by the compressed image
+ *  - DECODE_RAW <algorithm> <mapping> <parameter> <num bytes>, followed by the compressed image
+ *      decompress a compressed image, replies "OK <height> <width> <num channels>" followed by the pixels
+ *
+ * algorithm and mapping use the numbering of the interactive menu. parameter is the threshold for
+ * (joint) running-length encoding and the predictor for predictive encoding.
+ * Failed requests are answered with "ERROR <reason>". Header lines longer than 4 KiB, payloads and (padded) images
+ * larger than max_request_bytes are rejected before anything is allocated for them. After a request that cannot be
+ * answered in sync with the client (e.g. its payload was not read), the connection is closed.
+ *
+ * SIGINT/SIGTERM stop the daemon: open connections are shut down and the socket file is removed.
+ */
+class CompressionDaemon
+{
+public:
+    CompressionDaemon(
+        const std::string& socket_path, std::size_t num_workers, std::size_t max_request_bytes = DEFAULT_MAX_REQUEST_BYTES
+    );
+    virtual ~CompressionDaemon() = default;
+
+    // listen on the socket and serve requests until SIGINT/SIGTERM, returns false if the socket cannot be set up
+    // Note: an existing file at the socket path is only replaced if it is a socket
+    bool run();
+
+private:
+    // compressors of a worker, indexed by algorithm, mapping and predictor
+    typedef std::map<std::string, std::unique_ptr<BaseImageCompression>> _CompressorCache;
+
+    void work();
+    void serveConnection(int connection, _CompressorCache& cache);
+    // serve a single request, returns false if the connection must be closed
+    bool serveRequest(int connection, const std::string& request, _CompressorCache& cache);
+    // get a compressor configured for the request parameters, nullptr if they are invalid
+    BaseImageCompression* getCompressor(int algorithm, int mapping, double parameter, _CompressorCache& cache);
+    // check that an image of the given size is within max_request_bytes
+    bool withinRequestLimit(std::size_t height, std::size_t width, std::size_t num_channels) const;
+
+    std::string _socket_path;
+    std::size_t _num_workers;
+    std::size_t _max_request_bytes;
+    std::queue<int> _connections;
+    std::set<int> _active_connections;  // connections being served, shut down when the daemon stops
+    bool _stopping = false;
+    std::mutex _connections_mutex;
+    std::condition_variable _connections_available;
+};
+
+#endif // COMPRESSION_DAEMON
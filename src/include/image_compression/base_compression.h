@@ -3,11 +3,11 @@
 #define BASE_COMPRESSION
 #include <iostream>
 #include <fstream>
+#include <vector>
 #include <opencv2/opencv.hpp>
 #include "include/general_helpers.h"
+#include "include/linear_mapping/base_linear_mapping.h"
 
-const std::size_t BUFFER_SIZE = 64 << 20;
-static uchar compression_buffer[BUFFER_SIZE];  // 64MB compression buffer
 const std::size_t MAX_NUM_CHANNELS = 4UL;
 
 #define locByte(arr, i)     *(uint8_t*)  (&arr[i])
@@ -15,6 +15,18 @@ const std::size_t MAX_NUM_CHANNELS = 4UL;
 #define locWord(arr, i)     *(uint32_t*) (&arr[i])
 #define locDWord(arr, i)    *(uint64_t*) (&arr[i])
 
+// locate channel c of the pixel at pt in an interleaved 8-bit image
+inline uchar& locPixel(cv::Mat& img, cv::Point pt, std::size_t c)
+    { return img.ptr<uchar>(pt.y)[pt.x * img.channels() + c]; }
+inline const uchar& locPixel(const cv::Mat& img, cv::Point pt, std::size_t c)
+    { return img.ptr<uchar>(pt.y)[pt.x * img.channels() + c]; }
+
+// convert between the 8-bit pixel values of images and the float32 values used internally
+inline float toFloatPixel(uchar val)
+    { return (float) (val * (1. / 255.)); }
+inline uchar toBytePixel(float val)
+    { return cv::saturate_cast<uchar>(val * 255.); }
+
 
 /*
  * Base class for image compressors
@@ -23,15 +35,25 @@ const std::size_t MAX_NUM_CHANNELS = 4UL;
  *  - (1): load an image into the compressor and encode it into a compressed binary file
  *  - (2): usage (1) but reverse
  * 
- * Incoming images are splited into different color channels for processing.
+ * Incoming images are processed one color channel at a time, without splitting them into separate frames.
  * To implement a compression algorithm, the following functions must be overridden:
  *  - readFrame
  *  - writeFrame
  *  - encodeFrame
  *  - decodeFrame
  * 
- * The read/write functions process single-channel float32 image frames.
+ * The read/write functions access a single channel of the interleaved 8-bit image in place.
  * The encode/decode functions process the binary data on the buffer, stored as a uchar array.
+ * Every compressor owns its buffer, so different compressors can be used concurrently.
+ * 
+ * Optionally, an auxiliary section stored after the frames can be added by overriding:
+ *  - getAuxiliaryBytes
+ *  - encodeAuxiliary
+ *  - decodeAuxiliary
+ * 
+ * Decoding never trusts the file: decodeFrame/decodeAuxiliary reject corrupt data,
+ * and checkPaddedSize can reject padded dimensions the compressor would not have produced.
+ * Compressors padding the image for a linear mapping can use setPaddedSize/matchesPaddedSize for both.
  * 
  */
 class BaseImageCompression
@@ -50,11 +72,19 @@ public:
     virtual void encode(std::ostream& file);
 
     // decode binary file and load image into compressor
-    virtual void decode(std::istream& file);
+    // Note: returns false and unloads the compressor if the file is truncated or corrupt
+    virtual bool decode(std::istream& file);
+
+    // decode metadata and auxiliary section of a binary file without loading its frames
+    // Note: file must be seekable, returns false if the file is truncated or corrupt
+    bool decodeAuxiliarySection(std::istream& file);
 
     // get data dimensions and compression summary (e.g. compression ratio)
     virtual void info() const;
 
+    // number of bytes left in file, SIZE_MAX if the file is not seekable
+    static std::size_t remainingBytes(std::istream& file);
+
     bool loaded() const
         { return (bool) _num_channels; }
     std::size_t getNumChannels() const
@@ -75,26 +105,68 @@ public:
         { return _num_bytes[frame_index]; }
     void setNumBytes(std::size_t frame_index, std::size_t num_bytes)
         { _num_bytes[frame_index] = num_bytes; }
+
+    // print progress banners and timings of read/write/encode/decode to std::cout (on by default)
+    bool getVerbose() const
+        { return _verbose; }
+    void setVerbose(bool verbose)
+        { _verbose = verbose; }
+
+protected:
+    // set the padded dimensions to the ones mapping covers for an image of height x width
+    void setPaddedSize(const BaseLinearMapping& mapping, std::size_t height, std::size_t width);
+
+    // check that the padded dimensions are the ones mapping covers for the loaded image
+    bool matchesPaddedSize(const BaseLinearMapping& mapping) const;
     
 private:
-    // load frame into compressor
-    // Note: frame is a single-channel float32 image
+    // load channel frame_index of image into compressor
+    // Note: image is the interleaved 8-bit source, pixels outside of it are padding
     // Note: the number of bytes required for the compressed frame must be updated using setNumBytes
-    virtual void readFrame(cv::Mat& frame, std::size_t frame_index) = 0;
+    virtual void readFrame(const cv::Mat& image, std::size_t frame_index) = 0;
 
-    // save compressed image into frame
-    // Note: frame MUST be a single-channel float32 image
-    virtual void writeFrame(cv::Mat& frame, std::size_t frame_index) = 0;
+    // save compressed frame into channel frame_index of image
+    // Note: image MUST be an interleaved 8-bit image with getNumChannels() channels
+    virtual void writeFrame(cv::Mat& image, std::size_t frame_index) = 0;
 
     // write buffer from begin (inclusive) to end (exclusive) with compressed image data
     virtual void encodeFrame(uchar* buffer, std::size_t frame_index, std::size_t begin, std::size_t end) = 0;
 
     // read buffer from begin (inclusive) to end (exclusive) and load image data into compressor
-    virtual void decodeFrame(uchar* buffer, std::size_t frame_index, std::size_t begin, std::size_t end) = 0;
+    // Note: must return false if the data does not cover exactly the padded image
+    virtual bool decodeFrame(uchar* buffer, std::size_t frame_index, std::size_t begin, std::size_t end) = 0;
+
+    // number of bytes of the auxiliary section, no section is written if 0
+    virtual std::size_t getAuxiliaryBytes() const
+        { return 0; }
+
+    // write buffer from begin (inclusive) to end (exclusive) with the auxiliary section
+    virtual void encodeAuxiliary(uchar* buffer, std::size_t begin, std::size_t end) {}
+
+    // read the auxiliary section from begin (inclusive) to end (exclusive) of buffer, false if it is corrupt
+    virtual bool decodeAuxiliary(uchar* buffer, std::size_t begin, std::size_t end)
+        { return true; }
+
+    // check the decoded padded dimensions against the ones read would use for the decoded image
+    // Note: not called by decodeAuxiliarySection, which does not depend on the padding
+    virtual bool checkPaddedSize() const
+        { return true; }
+
+    // load metadata from buffer, false if it is invalid
+    bool decodeMetadata(uchar* buffer, std::size_t& auxiliary_bytes);
+
+    // sum the frame sizes of the loaded metadata, false if frames and auxiliary section
+    // do not fit in the remaining_bytes following the start of the metadata
+    bool checkPayloadBytes(std::size_t auxiliary_bytes, std::size_t remaining_bytes, std::size_t& frame_bytes) const;
+
+    // get the compression buffer with at least num_bytes bytes
+    uchar* reserveBuffer(std::size_t num_bytes);
     
     static const std::size_t _METADATA_SIZE;
     std::size_t _num_bytes[MAX_NUM_CHANNELS];
+    std::vector<uchar> _buffer;  // compression buffer, kept between images
     bool _padding;
+    bool _verbose = true;
     std::size_t _num_channels = 0;
     std::size_t _height = 0;
     std::size_t _width = 0;
@@ -102,6 +174,4 @@ private:
     std::size_t _padded_width = 0;
 };
 
-void addPadding(cv::Mat& input_img, cv::Mat& output_img, std::size_t padded_height, std::size_t padded_width);
-
 #endif // BASE_COMPRESSION
@@ -0,0 +1,55 @@
+#ifndef JOINT_RUNNING_LENGTH_ENCODING
+#define JOINT_RUNNING_LENGTH_ENCODING
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include "base_compression.h"
+#include "include/linear_mapping/base_linear_mapping.h"
+
+/* 
+ * Map image onto a linear array and perform running-length encoding on whole pixels
+ *
+ * All channels are traversed at once and share their runs: a run ends as soon as any channel leaves the threshold.
+ * Every block stores a single count followed by the value of each channel, so all data is kept in frame 0
+ * and the other frames are empty.
+ */
+class JointRunningLengthEncoding : public BaseImageCompression
+{
+public:
+    // mapping: a dynamically allocated BaseLinearMapping object, do NOT use pointer to static object
+    JointRunningLengthEncoding(BaseLinearMapping* mapping, float threshold);
+    virtual ~JointRunningLengthEncoding();
+
+    virtual void read(cv::Mat& image);
+    virtual void write(cv::Mat& image, bool show_padding = false);
+    virtual void encode(std::ostream& file);
+    virtual bool decode(std::istream& file);
+    virtual void info() const;
+
+    float getThreshold() const
+        { return _threshold; }
+    void setThreshold(float threshold)
+        { _threshold = threshold; }
+
+private:
+    virtual void readFrame(const cv::Mat& image, std::size_t frame_index);
+    virtual void writeFrame(cv::Mat& image, std::size_t frame_index);
+    virtual void encodeFrame(uchar* buffer, std::size_t frame_index, std::size_t begin, std::size_t end);
+    virtual bool decodeFrame(uchar* buffer, std::size_t frame_index, std::size_t begin, std::size_t end);
+    virtual bool checkPaddedSize() const
+        { return matchesPaddedSize(*_mapping); }
+    std::size_t getBlockSize() const
+        { return _COUNT_SIZE + getNumChannels(); }
+    BaseLinearMapping* _mapping;
+    float _threshold;
+    struct _PixelBlock
+    {
+        std::size_t frequency;
+        float values[MAX_NUM_CHANNELS];
+    };
+    std::vector<_PixelBlock> _pixel_blocks;
+
+    static const std::size_t _COUNT_SIZE;
+};
+
+#endif // JOINT_RUNNING_LENGTH_ENCODING
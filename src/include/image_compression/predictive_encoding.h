@@ -0,0 +1,59 @@
+#ifndef PREDICTIVE_ENCODING
+#define PREDICTIVE_ENCODING
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include "base_compression.h"
+#include "run_length_kernels.h"
+#include "include/linear_mapping/base_linear_mapping.h"
+
+/*
+ * Map image onto a linear array, predict every pixel from the previous ones along the curve
+ * and perform running-length encoding on the prediction residuals
+ *
+ * Smooth gradients have constant residuals and therefore collapse into long runs.
+ * Residuals are taken modulo 256, so the compression is lossless.
+ */
+class PredictiveEncoding : public BaseImageCompression
+{
+public:
+    enum Predictor
+    {
+        PREVIOUS,  // value of the previous pixel
+        LINEAR     // linear extrapolation from the previous two pixels
+    };
+
+    // mapping: a dynamically allocated BaseLinearMapping object, do NOT use pointer to static object
+    PredictiveEncoding(BaseLinearMapping* mapping, Predictor predictor);
+    virtual ~PredictiveEncoding();
+
+    virtual void read(cv::Mat& image);
+    virtual void write(cv::Mat& image, bool show_padding = false);
+    virtual void encode(std::ostream& file);
+    virtual bool decode(std::istream& file);
+    virtual void info() const;
+
+private:
+    virtual void readFrame(const cv::Mat& image, std::size_t frame_index);
+    virtual void writeFrame(cv::Mat& image, std::size_t frame_index);
+    virtual void encodeFrame(uchar* buffer, std::size_t frame_index, std::size_t begin, std::size_t end);
+    virtual bool decodeFrame(uchar* buffer, std::size_t frame_index, std::size_t begin, std::size_t end);
+    virtual bool checkPaddedSize() const
+        { return matchesPaddedSize(*_mapping); }
+    // predict the next value from the last (prev_val) and second to last (prev_prev_val) values
+    uchar predict(uchar prev_val, uchar prev_prev_val) const
+        { return _predictor == LINEAR ? (uchar) (2 * prev_val - prev_prev_val) : prev_val; }
+    BaseLinearMapping* _mapping;
+    Predictor _predictor;
+    struct _ResidualBlock
+    {
+        std::size_t frequency;
+        uchar residual;
+    };
+    std::vector<_ResidualBlock> _residual_block_arrays[MAX_NUM_CHANNELS];
+    std::vector<uchar> _curve_residuals;  // residuals of a channel in curve order
+
+    static const std::size_t _RESIDUAL_BLOCK_SIZE;
+};
+
+#endif // PREDICTIVE_ENCODING
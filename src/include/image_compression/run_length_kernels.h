@@ -0,0 +1,27 @@
+#ifndef RUN_LENGTH_KERNELS
+#define RUN_LENGTH_KERNELS
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+/*
+ * Run boundary detection on 8-bit values stored in curve order
+ *
+ * A kernel returns the length of the run of values equal to values[0], scanning at most max_length values
+ * (max_length must be at least 1). Vectorised kernels compare many values at once and locate the first
+ * mismatch from the comparison mask, the best kernel supported by the CPU is picked at runtime.
+ */
+typedef std::size_t (*RunLengthKernel)(const uchar* values, std::size_t max_length);
+
+// reference implementation, every other kernel must match it exactly
+std::size_t runLengthScalar(const uchar* values, std::size_t max_length);
+
+// get the fastest kernel supported by the CPU, falling back to the scalar kernel if it fails checkRunLengthKernel
+RunLengthKernel selectRunLengthKernel();
+
+// get the name of the instruction set used by selectRunLengthKernel
+const char* runLengthKernelName();
+
+// check that kernel agrees with the scalar kernel on synthetic runs
+bool checkRunLengthKernel(RunLengthKernel kernel);
+
+#endif // RUN_LENGTH_KERNELS
@@ -3,7 +3,9 @@
 #include <opencv2/opencv.hpp>
 #include <vector>
 #include <random>
+#include <thread>
 #include "base_compression.h"
+#include "run_length_kernels.h"
 #include "include/linear_mapping/base_linear_mapping.h"
 
 /* 
@@ -20,23 +22,68 @@ public:
     virtual void write(cv::Mat& image, bool show_padding = false);
     virtual void visualiseEncoding(cv::Mat& image, bool show_padding = false);
     virtual void encode(std::ostream& file);
-    virtual void decode(std::istream& file);
+    virtual bool decode(std::istream& file);
     virtual void info() const;
 
+    float getThreshold() const
+        { return _threshold; }
+    void setThreshold(float threshold)
+        { _threshold = threshold; }
+
+    // number of threads used by write (1 disables multithreaded decoding)
+    std::size_t getNumThreads() const
+        { return _num_threads; }
+    void setNumThreads(std::size_t num_threads)
+        { _num_threads = std::max<std::size_t>(num_threads, 1); }
+
+    // number of preview levels stored by encode (0 disables the preview pyramid)
+    // Note: level k is a 1/2^k resolution thumbnail, must be set before read
+    std::size_t getPyramidLevels() const
+        { return _pyramid_levels; }
+    void setPyramidLevels(std::size_t levels)
+        { _pyramid_levels = levels; }
+    std::size_t getNumPreviewLevels() const
+        { return _pyramid.size(); }
+
+    // overwrite thumbnail with preview level (within [1, getNumPreviewLevels()]) of the loaded image
+    // Note: returns false and leaves thumbnail empty if level is out of range
+    bool preview(std::size_t level, cv::Mat& thumbnail) const;
+
+    // decode only the preview pyramid of a binary file, without touching its pixel blocks
+    // Note: file must be seekable, returns false and leaves thumbnail empty if level is out of range
+    bool decodePreview(std::istream& file, std::size_t level, cv::Mat& thumbnail);
+
 private:
-    virtual void readFrame(cv::Mat& frame, std::size_t frame_index);
-    virtual void writeFrame(cv::Mat& frame, std::size_t frame_index);
+    virtual void readFrame(const cv::Mat& image, std::size_t frame_index);
+    // lossless case of readFrame: runs are exactly the runs of equal values, found by a vectorised kernel
+    void readFrameLossless(const cv::Mat& image, std::size_t frame_index);
+    virtual void writeFrame(cv::Mat& image, std::size_t frame_index);
+    // multithreaded writeFrame: every thread expands the blocks of its own slice of the curve
+    void writeFrameParallel(cv::Mat& image, std::size_t frame_index);
+    // record the preview levels of channel frame_index of image
+    void recordPyramid(const cv::Mat& image, std::size_t frame_index);
+    virtual std::size_t getAuxiliaryBytes() const;
+    virtual void encodeAuxiliary(uchar* buffer, std::size_t begin, std::size_t end);
+    virtual bool decodeAuxiliary(uchar* buffer, std::size_t begin, std::size_t end);
+    // allocate levels of the preview pyramid of an image
+    void allocatePyramid(std::size_t levels, std::size_t height, std::size_t width, std::size_t num_channels);
     virtual void encodeFrame(uchar* buffer, std::size_t frame_index, std::size_t begin, std::size_t end);
-    virtual void decodeFrame(uchar* buffer, std::size_t frame_index, std::size_t begin, std::size_t end);
+    virtual bool decodeFrame(uchar* buffer, std::size_t frame_index, std::size_t begin, std::size_t end);
+    virtual bool checkPaddedSize() const
+        { return matchesPaddedSize(*_mapping); }
     BaseLinearMapping* _mapping;
     float _threshold;
     bool _random_colors = false;
+    std::size_t _num_threads = std::max(std::thread::hardware_concurrency(), 1U);
     struct _PixelBlock
     {
         std::size_t frequency;
         float value;
     };
     std::vector<_PixelBlock> _pixel_block_arrays[MAX_NUM_CHANNELS];
+    std::vector<uchar> _curve_values;  // values of a channel in curve order
+    std::size_t _pyramid_levels = 0;
+    std::vector<cv::Mat> _pyramid;  // preview level k is stored at k - 1
 
     static const std::size_t _PIXEL_BLOCK_SIZE;
 };
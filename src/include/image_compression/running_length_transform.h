@@ -0,0 +1,75 @@
+#ifndef RUNNING_LENGTH_TRANSFORM
+#define RUNNING_LENGTH_TRANSFORM
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include "base_compression.h"
+#include "include/linear_mapping/base_linear_mapping.h"
+
+/*
+ * Transforms of running-length encoded images, performed on the compressed blocks without decoding any pixel
+ *
+ * Usage: load a compressed image, apply any number of transforms and save the result.
+ * The cost of a transform is proportional to the number of blocks instead of the number of pixels.
+ * Transforms that depend on the shape of the curve take the linear mapping the image was encoded with,
+ * and return false (leaving the image unchanged) if the mapping or the image does not support them.
+ * The auxiliary section (e.g. preview pyramid) is dropped since it would not match the transformed image.
+ */
+class RunningLengthTransform
+{
+public:
+    RunningLengthTransform() = default;
+    virtual ~RunningLengthTransform() = default;
+
+    // load a compressed image written by RunningLengthEncoding
+    // Note: returns false and unloads the image if the file is truncated or corrupt
+    bool load(std::istream& file);
+
+    // write the transformed image in the format of RunningLengthEncoding
+    void save(std::ostream& file) const;
+
+    // keep channel as the only channel of the image
+    void extractChannel(std::size_t channel);
+
+    // merge adjacent blocks like encoding with a coarser pixel value threshold (within [0, 1]) would
+    void requantize(float threshold);
+
+    // keep a quadrant (0: top-left, 1: top-right, 2: bottom-left, 3: bottom-right) of the padded image
+    // Note: supported for all quadrants of Morton curves and for the bottom quadrants of Hilbert curves,
+    //       as long as the image part of the quadrant is more than half of the quadrant in height or width
+    bool cropQuadrant(const BaseLinearMapping& mapping, int quadrant);
+
+    // mirror the image horizontally by reversing the Hilbert curve
+    // Note: only supported for Hilbert curves with unpadded width
+    bool flipHorizontal(const BaseLinearMapping& mapping);
+
+    // rotate the image by 180 degrees by reversing the Morton curve
+    // Note: only supported for Morton curves without padding
+    bool rotate180(const BaseLinearMapping& mapping);
+
+    std::size_t getNumChannels() const
+        { return _num_channels; }
+    std::size_t getHeight() const
+        { return _height; }
+    std::size_t getWidth() const
+        { return _width; }
+    std::size_t getNumBlocks(std::size_t frame_index) const
+        { return _frames[frame_index].size() / _PIXEL_BLOCK_SIZE; }
+
+private:
+    // reverse the order of the blocks of every frame
+    void reverseBlocks();
+
+    std::size_t _num_channels = 0;
+    std::size_t _height = 0;
+    std::size_t _width = 0;
+    bool _padding = true;
+    std::size_t _padded_height = 0;
+    std::size_t _padded_width = 0;
+    std::vector<uchar> _frames[MAX_NUM_CHANNELS];  // encoded pixel blocks of every frame
+
+    static const std::size_t _METADATA_SIZE;
+    static const std::size_t _PIXEL_BLOCK_SIZE;
+};
+
+#endif // RUNNING_LENGTH_TRANSFORM
@@ -0,0 +1,76 @@
+#ifndef TILED_COMPRESSION
+#define TILED_COMPRESSION
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "include/image_compression/base_compression.h"
+#include "include/raw_image.h"
+
+// the largest supported tile, bounds the memory used for a single tile
+const std::size_t MAX_TILE_SIZE = 2048;
+
+/*
+ * Out-of-core compression of images that do not fit in memory
+ *
+ * The image is read from a raw image in square tiles aligned to the linear mappings
+ * (i.e. the tile size is a power of 2). Every tile is compressed on its own by the wrapped compressor,
+ * so memory usage is bounded by the tile size instead of the image size.
+ *
+ * Layout of the output:
+ *  - metadata (128B, see encode)
+ *  - the compressed stream of every tile, in row-major tile order
+ *  - tile index: (unsigned long) offset and (unsigned long) size of every tile stream
+ *  - (unsigned long) offset of the tile index
+ */
+class TiledCompression
+{
+public:
+    // compressor: a dynamically allocated BaseImageCompression object, do NOT use pointer to static object
+    TiledCompression(BaseImageCompression* compressor, std::size_t tile_size);
+    virtual ~TiledCompression();
+
+    // compress the image tile by tile and write the tile streams with their index into file,
+    // false if the raw image could not be read
+    bool compress(RawImageReader& reader, std::ostream& file);
+
+    // load metadata and tile index of a tiled file, must be called before decodeTile/decompress
+    // Note: file must be seekable, returns false if the file is truncated or corrupt
+    bool open(std::istream& file);
+
+    // decompress a single tile of an opened file into tile, false if its stream is corrupt
+    bool decodeTile(std::istream& file, std::size_t tile_y, std::size_t tile_x, cv::Mat& tile);
+
+    // decompress every tile of an opened file into writer, false if a tile stream is corrupt
+    bool decompress(std::istream& file, RawImageWriter& writer);
+
+    std::size_t getNumChannels() const
+        { return _num_channels; }
+    std::size_t getHeight() const
+        { return _height; }
+    std::size_t getWidth() const
+        { return _width; }
+    std::size_t getTileSize() const
+        { return _tile_size; }
+    std::size_t getNumTilesY() const
+        { return (_height + _tile_size - 1) / _tile_size; }
+    std::size_t getNumTilesX() const
+        { return (_width + _tile_size - 1) / _tile_size; }
+
+private:
+    BaseImageCompression* _compressor;
+    std::size_t _tile_size;
+    std::size_t _num_channels = 0;
+    std::size_t _height = 0;
+    std::size_t _width = 0;
+    struct _TileEntry
+    {
+        std::size_t offset;
+        std::size_t size;
+    };
+    std::vector<_TileEntry> _tile_index;
+
+    static const std::size_t _METADATA_SIZE;
+};
+
+#endif // TILED_COMPRESSION
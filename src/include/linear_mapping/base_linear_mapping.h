@@ -14,6 +14,17 @@ public:
     virtual ~BaseLinearMapping() = default;
     virtual void preprocess(std::size_t height, std::size_t width) = 0;
     virtual cv::Point next() = 0;
+    // random access to the points generated by preprocess, returns POINT_END past the end of the curve
+    virtual cv::Point at(std::size_t index) const = 0;
+    virtual std::size_t size() const = 0;
+    // size of the padded image covered by the curve, a square with a power of 2 side by default
+    virtual cv::Size getPaddedSize(std::size_t height, std::size_t width) const
+    {
+        std::size_t side = 1;
+        while (side < std::max(height, width))
+            side <<= 1;
+        return cv::Size(side, side);
+    }
     
 private:
 };
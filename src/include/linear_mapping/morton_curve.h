@@ -1,7 +1,9 @@
 
+#ifndef MORTON_CURVE
+#define MORTON_CURVE
 #include <iostream>
 #include <opencv2/opencv.hpp>
-#include <queue>
+#include <vector>
 #include "include/linear_mapping/base_linear_mapping.h"
 
 class MortonCurve : public BaseLinearMapping
@@ -11,8 +13,16 @@ public:
     virtual ~MortonCurve() = default;
     virtual void preprocess(std::size_t height, std::size_t width);
     virtual cv::Point next();
+    virtual cv::Point at(std::size_t index) const;
+    virtual std::size_t size() const
+        { return points.size(); }
 private:
     // O(n) space O(n) time implementation
     void generatePointsHelper(int yi, int yj, int xi, int xj);
-    std::queue<cv::Point> points;
+    std::vector<cv::Point> points;
+    std::size_t cursor = 0;
+    std::size_t _height = 0;  // size of the generated points
+    std::size_t _width = 0;
 };
+
+#endif // MORTON_CURVE
@@ -0,0 +1,38 @@
+
+#ifndef TILED_HILBERT_CURVE
+#define TILED_HILBERT_CURVE
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include "include/linear_mapping/base_linear_mapping.h"
+
+/*
+ * Cache-blocked mapping: square tiles are visited in row-major order and a Hilbert curve is followed inside each tile
+ *
+ * The working set of a tile fits in cache, while a full-image curve jumps between distant rows
+ * at every high-level quadrant transition. The image is only padded up to a multiple of the tile size.
+ */
+class TiledHilbertCurve : public BaseLinearMapping
+{
+public:
+    // tile_size: side of the tiles, must be a power of 2
+    TiledHilbertCurve(std::size_t tile_size = 64);
+    virtual ~TiledHilbertCurve() = default;
+    virtual void preprocess(std::size_t height, std::size_t width);
+    virtual cv::Point next();
+    virtual cv::Point at(std::size_t index) const;
+    virtual std::size_t size() const
+        { return points.size(); }
+    virtual cv::Size getPaddedSize(std::size_t height, std::size_t width) const;
+    std::size_t getTileSize() const
+        { return _tile_size; }
+private:
+    std::size_t _tile_size;
+    std::vector<cv::Point> tile_points;  // Hilbert curve of a single tile
+    std::vector<cv::Point> points;
+    std::size_t cursor = 0;
+    std::size_t _height = 0;  // size of the generated points
+    std::size_t _width = 0;
+};
+
+#endif // TILED_HILBERT_CURVE
@@ -0,0 +1,56 @@
+#ifndef RAW_IMAGE
+#define RAW_IMAGE
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+/*
+ * Region-wise access to headerless raw images (interleaved 8-bit pixels, stored row by row)
+ *
+ * Only the requested region is ever held in memory, so images larger than RAM can be processed.
+ * The underlying stream must be seekable.
+ */
+class RawImageReader
+{
+public:
+    RawImageReader(std::istream& file, std::size_t height, std::size_t width, std::size_t num_channels);
+
+    // overwrite region with the pixels of the image within roi, false if the file is too short
+    bool readRegion(const cv::Rect& roi, cv::Mat& region);
+
+    std::size_t getNumChannels() const
+        { return _num_channels; }
+    std::size_t getHeight() const
+        { return _height; }
+    std::size_t getWidth() const
+        { return _width; }
+
+private:
+    std::istream& _file;
+    std::size_t _height;
+    std::size_t _width;
+    std::size_t _num_channels;
+};
+
+class RawImageWriter
+{
+public:
+    RawImageWriter(std::ostream& file, std::size_t height, std::size_t width, std::size_t num_channels);
+
+    // write region into the image with its top-left corner at origin
+    void writeRegion(const cv::Point& origin, const cv::Mat& region);
+
+    std::size_t getNumChannels() const
+        { return _num_channels; }
+    std::size_t getHeight() const
+        { return _height; }
+    std::size_t getWidth() const
+        { return _width; }
+
+private:
+    std::ostream& _file;
+    std::size_t _height;
+    std::size_t _width;
+    std::size_t _num_channels;
+};
+
+#endif // RAW_IMAGE
@@ -0,0 +1,153 @@
+#include "include/image_compression/joint_running_length_encoding.h"
+
+const std::size_t JointRunningLengthEncoding::_COUNT_SIZE = 2;
+
+JointRunningLengthEncoding::JointRunningLengthEncoding(BaseLinearMapping* mapping, float threshold)
+: BaseImageCompression(true), _mapping(mapping), _threshold(threshold)
+{
+
+}
+
+JointRunningLengthEncoding::~JointRunningLengthEncoding()
+{
+    delete _mapping;
+}
+
+void JointRunningLengthEncoding::read(cv::Mat& image)
+{
+    setPaddedSize(*_mapping, image.rows, image.cols);
+    _pixel_blocks.clear();
+    BaseImageCompression::read(image);
+}
+
+void JointRunningLengthEncoding::write(cv::Mat& image, bool show_padding)
+{
+    BaseImageCompression::write(image, show_padding);
+}
+
+void JointRunningLengthEncoding::info() const
+{
+    BaseImageCompression::info();
+}
+
+void JointRunningLengthEncoding::encode(std::ostream& file)
+{
+    BaseImageCompression::encode(file);
+}
+
+bool JointRunningLengthEncoding::decode(std::istream& file)
+{
+    return BaseImageCompression::decode(file);
+}
+
+void JointRunningLengthEncoding::readFrame(const cv::Mat& image, std::size_t frame_index)
+{
+    // all channels are read in a single traversal along with frame 0
+    if (frame_index != 0)
+    {
+        setNumBytes(frame_index, 0);
+        return;
+    }
+    _mapping->preprocess(getPaddedHeight(), getPaddedWidth());
+    const std::size_t num_channels = getNumChannels();
+    float vals[MAX_NUM_CHANNELS];
+    // Process first block
+    cv::Point pixel_loc = _mapping->next();
+    _PixelBlock first_block = {1, {}};
+    for (std::size_t c = 0; c < num_channels; c++)
+        first_block.values[c] = toFloatPixel(locPixel(image, pixel_loc, c));
+    _pixel_blocks.push_back(first_block);
+    // Process the rest
+    for (pixel_loc = _mapping->next(); pixel_loc != POINT_END; pixel_loc = _mapping->next())
+    {
+        _PixelBlock& block = _pixel_blocks.back();
+        // MAKE SURE FIRST PIXEL IS NON-EMPTY
+        // padding takes the values of the current block, like in RunningLengthEncoding
+        if (pixel_loc.y >= image.rows || pixel_loc.x >= image.cols)
+            std::copy(block.values, block.values + num_channels, vals);
+        else
+        {
+            const uchar* pixel = &locPixel(image, pixel_loc, 0);
+            for (std::size_t c = 0; c < num_channels; c++)
+                vals[c] = toFloatPixel(pixel[c]);
+        }
+        bool new_block = block.frequency >= UINT16_MAX;
+        for (std::size_t c = 0; c < num_channels && !new_block; c++)
+            new_block = std::fabs(vals[c] - block.values[c]) >= _threshold;
+        if (new_block)
+        {
+            _PixelBlock next_block = {1, {}};
+            std::copy(vals, vals + num_channels, next_block.values);
+            _pixel_blocks.push_back(next_block);
+        }
+        else
+        {
+            // add to block and update arithm. mean of every channel (numerically stable)
+            // https://dassencio.org/68
+            block.frequency++;
+            for (std::size_t c = 0; c < num_channels; c++)
+                block.values[c] = block.values[c] + (vals[c] - block.values[c]) / block.frequency;
+        }
+    }
+    // update number of bytes
+    setNumBytes(frame_index, getBlockSize() * _pixel_blocks.size());
+}
+
+void JointRunningLengthEncoding::writeFrame(cv::Mat& image, std::size_t frame_index)
+{
+    // all channels are written along with frame 0
+    if (frame_index != 0)
+        return;
+    _mapping->preprocess(getPaddedHeight(), getPaddedWidth());
+    const std::size_t num_channels = getNumChannels();
+    uchar pixel[MAX_NUM_CHANNELS];
+    cv::Point cur_pt;
+    for (const _PixelBlock& block : _pixel_blocks)
+    {
+        for (std::size_t c = 0; c < num_channels; c++)
+            pixel[c] = toBytePixel(block.values[c]);
+        for (std::size_t i = 0; i < block.frequency; i++)
+        {
+            cur_pt = _mapping->next();
+            if (cur_pt.y >= image.rows || cur_pt.x >= image.cols)
+                continue;
+            std::copy(pixel, pixel + num_channels, &locPixel(image, cur_pt, 0));
+        }
+    }
+}
+
+void JointRunningLengthEncoding::encodeFrame(uchar* buffer, std::size_t frame_index, std::size_t begin, std::size_t end)
+{
+    if (frame_index != 0)
+        return;
+    std::size_t cur_pos = begin;
+    for (const _PixelBlock& block : _pixel_blocks)
+    {
+        assert(cur_pos < end);
+        locHWord(buffer, cur_pos) = (uint16_t) block.frequency;
+        for (std::size_t c = 0; c < getNumChannels(); c++)
+            locByte(buffer, cur_pos + _COUNT_SIZE + c) = (uchar) (block.values[c] * 255.);
+        cur_pos += getBlockSize();
+    }
+}
+
+bool JointRunningLengthEncoding::decodeFrame(uchar* buffer, std::size_t frame_index, std::size_t begin, std::size_t end)
+{
+    // every block is stored in frame 0
+    if (frame_index != 0)
+        return begin == end;
+    _pixel_blocks.clear();
+    if ((end - begin) % getBlockSize() != 0)
+        return false;
+    std::size_t num_points = 0;
+    for (std::size_t cur_pos = begin; cur_pos < end; cur_pos += getBlockSize())
+    {
+        _PixelBlock block = {locHWord(buffer, cur_pos), {}};
+        for (std::size_t c = 0; c < getNumChannels(); c++)
+            block.values[c] = (float) locByte(buffer, cur_pos + _COUNT_SIZE + c) / 255.0f;
+        _pixel_blocks.push_back(block);
+        num_points += block.frequency;
+    }
+    // writeFrame expands the blocks along the whole curve, no more and no less
+    return num_points == getPaddedHeight() * getPaddedWidth();
+}
@@ -1,21 +1,43 @@
 
 #include <iostream>
 #include <opencv2/opencv.hpp>
+#include <thread>
 #include "include/image_compression/running_length_encoding.h"
+#include "include/image_compression/predictive_encoding.h"
+#include "include/image_compression/joint_running_length_encoding.h"
+#include "include/image_compression/tiled_compression.h"
+#include "include/image_compression/running_length_transform.h"
+#include "include/compression_daemon.h"
 #include "include/linear_mapping/hilbert_curve.h"
 #include "include/linear_mapping/morton_curve.h"
+#include "include/linear_mapping/tiled_hilbert_curve.h"
 
 using namespace cv;
 using namespace std;
 
 string extractFilename(const string& filename);
 
+BaseLinearMapping* chooseLinearMapping();
 BaseImageCompression* chooseAlgorithm();
 bool compress(const string& filename);
 bool decompress(const string& filename);
+bool compressTiled(const string& filename);
+bool decompressTiled(const string& filename);
+bool preview(const string& filename);
+bool transformCompressed(const string& filename);
 
 int main(int argc, char** argv)
 {
+    // daemon mode: test --daemon [socket path] [number of workers] [max request bytes]
+    if (argc > 1 && string(argv[1]) == "--daemon")
+    {
+        string socket_path = argc > 2 ? argv[2] : "/tmp/the-great-compression.sock";
+        size_t num_workers = argc > 3 ? stoul(argv[3]) : max(thread::hardware_concurrency(), 1U);
+        size_t max_request_bytes = argc > 4 ? stoull(argv[4]) : DEFAULT_MAX_REQUEST_BYTES;
+        CompressionDaemon daemon(socket_path, num_workers, max_request_bytes);
+        return daemon.run() ? 0 : 1;
+    }
+
     int mode = 0;
     std::string filename;
     while (true)
@@ -23,7 +45,11 @@ int main(int argc, char** argv)
         cout << "Select mode..." << endl
             << "\t0: compression" << endl
             << "\t1: decompression" << endl
-            << "\t2: exit" << endl;
+            << "\t2: exit" << endl
+            << "\t3: tiled compression (raw image)" << endl
+            << "\t4: tiled decompression (raw image)" << endl
+            << "\t5: preview (running-length encoding)" << endl
+            << "\t6: compressed-domain transform (running-length encoding)" << endl;
         cout << "mode: ";
         cin >> mode;
         switch (mode)
@@ -42,6 +68,30 @@ int main(int argc, char** argv)
             break;
         case 2:
             return 0;
+        case 3:
+            // tiled compression
+            cout << "filename: ";
+            cin >> filename;
+            compressTiled(filename);
+            break;
+        case 4:
+            // tiled decompression
+            cout << "filename: ";
+            cin >> filename;
+            decompressTiled(filename);
+            break;
+        case 5:
+            // preview
+            cout << "filename: ";
+            cin >> filename;
+            preview(filename);
+            break;
+        case 6:
+            // compressed-domain transform
+            cout << "filename: ";
+            cin >> filename;
+            transformCompressed(filename);
+            break;
         
         default:
             cout << "Invalid mode." << endl;
@@ -56,15 +106,48 @@ string extractFilename(const string& filename)
     return filename.substr(0, filename.find('.'));
 }
 
+BaseLinearMapping* chooseLinearMapping()
+{
+    int linear_mapping;
+    cout << "Choose a linear mapping method..." << endl
+        << "\t0: Hilbert curve" << endl
+        << "\t1: Morton curve" << endl
+        << "\t2: tiled Hilbert curve (64x64 tiles)" << endl
+        << "linear mapping: ";
+    cin >> linear_mapping;
+
+    switch (linear_mapping)
+    {
+    case 0:
+        // Hilbert curve
+        return new HilbertCurve;
+
+    case 1:
+        // Morton Curve
+        return new MortonCurve;
+
+    case 2:
+        // Hilbert curve within row-major tiles
+        return new TiledHilbertCurve(64);
+
+    default:
+        cout << "Invalid linear mapping." << endl;
+        return nullptr;
+    }
+}
+
 BaseImageCompression* chooseAlgorithm()
 {
     int algorithm;
-    int linear_mapping;
+    int predictor;
     double threshold;
+    BaseLinearMapping* mapping;
     BaseImageCompression* encoder;
 
     cout << "Choose an algorithm..." << endl
         << "\t0: running-length encoding" << endl
+        << "\t1: predictive encoding" << endl
+        << "\t2: joint running-length encoding (all channels share runs)" << endl
         << "algorithm: ";
     cin >> algorithm;
 
@@ -72,32 +155,43 @@ BaseImageCompression* chooseAlgorithm()
     {
     case 0:
         // RLE
-        cout << "Choose a linear mapping method..." << endl
-            << "\t0: Hilbert curve" << endl
-            << "\t1: Morton curve" << endl
-            << "linear mapping: ";
-        cin >> linear_mapping;
+        mapping = chooseLinearMapping();
+        if (mapping == nullptr)
+            return nullptr;
         cout << "(threshold determines the 'lossiness' of compression; value < 0.0039 leads to loseless compression)\n";
         cout << "Pixel value threshold (within [0, 1]) for lossy compression: ";
         cin >> threshold;
+        encoder = new RunningLengthEncoding(mapping, threshold);
+        break;
 
-        switch (linear_mapping)
+    case 1:
+        // predictive encoding
+        mapping = chooseLinearMapping();
+        if (mapping == nullptr)
+            return nullptr;
+        cout << "Choose a predictor..." << endl
+            << "\t0: previous pixel" << endl
+            << "\t1: linear extrapolation" << endl
+            << "predictor: ";
+        cin >> predictor;
+        if (predictor != PredictiveEncoding::PREVIOUS && predictor != PredictiveEncoding::LINEAR)
         {
-        case 0:
-            // Hilbert curve
-            encoder = new RunningLengthEncoding(new HilbertCurve, threshold);
-            break;
-        
-        case 1:
-            // Morton Curve
-            encoder = new RunningLengthEncoding(new MortonCurve, threshold);
-            break;
-        
-        default:
-            cout << "Invalid linear mapping." << endl;
+            cout << "Invalid predictor." << endl;
+            delete mapping;
             return nullptr;
-            break;
         }
+        encoder = new PredictiveEncoding(mapping, (PredictiveEncoding::Predictor) predictor);
+        break;
+
+    case 2:
+        // joint RLE
+        mapping = chooseLinearMapping();
+        if (mapping == nullptr)
+            return nullptr;
+        cout << "(threshold determines the 'lossiness' of compression; value < 0.0039 leads to loseless compression)\n";
+        cout << "Pixel value threshold (within [0, 1]) for lossy compression: ";
+        cin >> threshold;
+        encoder = new JointRunningLengthEncoding(mapping, threshold);
         break;
     
     default:
@@ -122,6 +216,14 @@ bool compress(const string& filename)
     if (encoder == nullptr)
         return false;
 
+    if (typeid(*encoder) == typeid(RunningLengthEncoding))
+    {
+        size_t pyramid_levels;
+        cout << "Number of preview levels (0 = no preview): ";
+        cin >> pyramid_levels;
+        dynamic_cast<RunningLengthEncoding*>(encoder)->setPyramidLevels(pyramid_levels);
+    }
+
     encoder->read(input_img);
     encoder->info();
 
@@ -157,7 +259,12 @@ bool decompress(const string& filename)
     if (decoder == nullptr)
         return false;
 
-    decoder->decode(encoded_file);
+    if (!decoder->decode(encoded_file))
+    {
+        cout << "Cannot decode file. The file is truncated or was not written by this algorithm." << endl;
+        delete decoder;
+        return false;
+    }
     encoded_file.close();
     decoder->info();
 
@@ -171,3 +278,206 @@ bool decompress(const string& filename)
     delete decoder;
     return true;
 }
+
+bool compressTiled(const string& filename)
+{
+    string read_path = "data/input/" + filename;
+    string write_path = "data/compressed/" + extractFilename(filename) + ".tiled";
+    ifstream raw_file(
+        read_path,
+        std::ios::in | std::ios::binary
+    );
+    if (!raw_file.is_open())
+    {
+        cout << "Cannot open file. Please check file location." << endl;
+        return false;
+    }
+
+    size_t height, width, num_channels, tile_size;
+    cout << "(raw images store interleaved 8-bit pixels row by row, without a header)\n";
+    cout << "height: ";
+    cin >> height;
+    cout << "width: ";
+    cin >> width;
+    cout << "number of channels: ";
+    cin >> num_channels;
+    cout << "tile size (power of 2, at most " << MAX_TILE_SIZE << "): ";
+    cin >> tile_size;
+    if (tile_size == 0 || (tile_size & (tile_size - 1)) || tile_size > MAX_TILE_SIZE)
+    {
+        cout << "Invalid tile size." << endl;
+        return false;
+    }
+
+    BaseImageCompression* encoder = chooseAlgorithm();
+    if (encoder == nullptr)
+        return false;
+
+    RawImageReader reader(raw_file, height, width, num_channels);
+    TiledCompression tiled(encoder, tile_size);
+    ofstream encoded_file(write_path, std::ios::out | std::ios::binary);
+    if (!tiled.compress(reader, encoded_file))
+    {
+        cout << "The raw image is smaller than the given dimensions." << endl;
+        return false;
+    }
+    return true;
+}
+
+bool decompressTiled(const string& filename)
+{
+    string read_path = "data/compressed/" + filename;
+    string write_path = "data/output/" + extractFilename(filename) + ".raw";
+    ifstream encoded_file(
+        read_path,
+        std::ios::in | std::ios::binary
+    );
+    if (!encoded_file.is_open())
+    {
+        cout << "Cannot open file. Please check file location." << endl;
+        return false;
+    }
+
+    BaseImageCompression* decoder = chooseAlgorithm();
+    if (decoder == nullptr)
+        return false;
+
+    TiledCompression tiled(decoder, 1);
+    if (!tiled.open(encoded_file))
+    {
+        cout << "Cannot open file. The file is truncated or is not a tiled file." << endl;
+        return false;
+    }
+    cout << "Image dimensions: "
+        << tiled.getHeight() << " x " << tiled.getWidth() << " x " << tiled.getNumChannels() << endl;
+    ofstream raw_file(write_path, std::ios::out | std::ios::binary);
+    RawImageWriter writer(raw_file, tiled.getHeight(), tiled.getWidth(), tiled.getNumChannels());
+    if (!tiled.decompress(encoded_file, writer))
+    {
+        cout << "Cannot decode file. The file is truncated or was not written by this algorithm." << endl;
+        return false;
+    }
+    return true;
+}
+
+bool preview(const string& filename)
+{
+    string read_path = "data/compressed/" + filename;
+    ifstream encoded_file(
+        read_path,
+        std::ios::in | std::ios::binary
+    );
+    if (!encoded_file.is_open())
+    {
+        cout << "Cannot open file. Please check file location." << endl;
+        return false;
+    }
+
+    // the linear mapping does not matter, only the metadata and the preview pyramid are decoded
+    RunningLengthEncoding decoder(new HilbertCurve, 0.);
+    if (!decoder.decodeAuxiliarySection(encoded_file))
+    {
+        cout << "Cannot decode file. The file is truncated or corrupt." << endl;
+        return false;
+    }
+    if (decoder.getNumPreviewLevels() == 0)
+    {
+        cout << "The file has no preview." << endl;
+        return false;
+    }
+
+    size_t level;
+    cout << "Preview level (within [1, " << decoder.getNumPreviewLevels() << "]): ";
+    cin >> level;
+    Mat thumbnail;
+    if (!decoder.preview(level, thumbnail))
+    {
+        cout << "Invalid preview level." << endl;
+        return false;
+    }
+    string write_path = "data/output/" + extractFilename(filename) + "_preview" + to_string(level) + ".png";
+    cv::imwrite(write_path, thumbnail);
+    return true;
+}
+
+bool transformCompressed(const string& filename)
+{
+    string read_path = "data/compressed/" + filename;
+    string write_path = "data/compressed/" + extractFilename(filename) + "_transformed.compressed";
+    ifstream encoded_file(
+        read_path,
+        std::ios::in | std::ios::binary
+    );
+    if (!encoded_file.is_open())
+    {
+        cout << "Cannot open file. Please check file location." << endl;
+        return false;
+    }
+
+    RunningLengthTransform transformer;
+    if (!transformer.load(encoded_file))
+    {
+        cout << "Cannot decode file. The file is truncated or was not written by this algorithm." << endl;
+        return false;
+    }
+    encoded_file.close();
+
+    BaseLinearMapping* mapping = chooseLinearMapping();
+    if (mapping == nullptr)
+        return false;
+
+    int operation;
+    cout << "Choose a transform..." << endl
+        << "\t0: extract channel" << endl
+        << "\t1: re-quantize with a coarser threshold" << endl
+        << "\t2: crop quadrant" << endl
+        << "\t3: flip horizontally (Hilbert curve)" << endl
+        << "\t4: rotate by 180 degrees (Morton curve)" << endl
+        << "transform: ";
+    cin >> operation;
+
+    bool supported = true;
+    size_t channel;
+    double threshold;
+    int quadrant;
+    switch (operation)
+    {
+    case 0:
+        cout << "channel (within [0, " << transformer.getNumChannels() - 1 << "]): ";
+        cin >> channel;
+        supported = channel < transformer.getNumChannels();
+        if (supported)
+            transformer.extractChannel(channel);
+        break;
+    case 1:
+        cout << "Pixel value threshold (within [0, 1]): ";
+        cin >> threshold;
+        transformer.requantize(threshold);
+        break;
+    case 2:
+        cout << "quadrant (0: top-left, 1: top-right, 2: bottom-left, 3: bottom-right): ";
+        cin >> quadrant;
+        supported = transformer.cropQuadrant(*mapping, quadrant);
+        break;
+    case 3:
+        supported = transformer.flipHorizontal(*mapping);
+        break;
+    case 4:
+        supported = transformer.rotate180(*mapping);
+        break;
+    default:
+        cout << "Invalid transform." << endl;
+        delete mapping;
+        return false;
+    }
+    delete mapping;
+    if (!supported)
+    {
+        cout << "The transform is not supported for this image and linear mapping." << endl;
+        return false;
+    }
+
+    ofstream transformed_file(write_path, std::ios::out | std::ios::binary);
+    transformer.save(transformed_file);
+    return true;
+}
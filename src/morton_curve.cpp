@@ -15,7 +15,7 @@ void MortonCurve::generatePointsHelper(int yi, int yj, int xi, int xj)
         return;
     if (pixels == 1)
     {
-        points.push(cv::Point(xi, yi));
+        points.push_back(cv::Point(xi, yi));
         return;
     }
     int mid_y, mid_x;
@@ -29,15 +29,27 @@ void MortonCurve::generatePointsHelper(int yi, int yj, int xi, int xj)
 
 cv::Point MortonCurve::next()
 {
-    if (points.empty())
+    if (cursor >= points.size())
         return POINT_END;
-    cv::Point result = points.front();
-    points.pop();
-    return result;
+    return points[cursor++];
+}
+
+cv::Point MortonCurve::at(std::size_t index) const
+{
+    if (index >= points.size())
+        return POINT_END;
+    return points[index];
 }
 
 void MortonCurve::preprocess(std::size_t height, std::size_t width)
 {
-    points = {};
+    // reuse the points of the previous call for the same size
+    cursor = 0;
+    if (height == _height && width == _width)
+        return;
+    _height = height;
+    _width = width;
+    points.clear();
+    points.reserve(height * width);
     generatePointsHelper(0, height, 0, width);
 }
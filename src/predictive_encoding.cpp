@@ -0,0 +1,123 @@
+#include "include/image_compression/predictive_encoding.h"
+
+const std::size_t PredictiveEncoding::_RESIDUAL_BLOCK_SIZE = 3;
+
+PredictiveEncoding::PredictiveEncoding(BaseLinearMapping* mapping, Predictor predictor)
+: BaseImageCompression(true), _mapping(mapping), _predictor(predictor)
+{
+
+}
+
+PredictiveEncoding::~PredictiveEncoding()
+{
+    delete _mapping;
+}
+
+void PredictiveEncoding::read(cv::Mat& image)
+{
+    setPaddedSize(*_mapping, image.rows, image.cols);
+    for (std::size_t i = 0; i < MAX_NUM_CHANNELS; i++)
+        _residual_block_arrays[i].clear();
+    BaseImageCompression::read(image);
+}
+
+void PredictiveEncoding::write(cv::Mat& image, bool show_padding)
+{
+    BaseImageCompression::write(image, show_padding);
+}
+
+void PredictiveEncoding::info() const
+{
+    BaseImageCompression::info();
+}
+
+void PredictiveEncoding::encode(std::ostream& file)
+{
+    BaseImageCompression::encode(file);
+}
+
+bool PredictiveEncoding::decode(std::istream& file)
+{
+    return BaseImageCompression::decode(file);
+}
+
+void PredictiveEncoding::readFrame(const cv::Mat& image, std::size_t frame_index)
+{
+    _mapping->preprocess(getPaddedHeight(), getPaddedWidth());
+    std::vector<_ResidualBlock>& residual_blocks = _residual_block_arrays[frame_index];
+    // compute residuals in curve order
+    _curve_residuals.resize(getPaddedHeight() * getPaddedWidth());
+    std::size_t num_residuals = 0;
+    uchar prev_val = 0, prev_prev_val = 0, residual = 0, val;
+    for (cv::Point pixel_loc = _mapping->next(); pixel_loc != POINT_END; pixel_loc = _mapping->next())
+    {
+        uchar predicted_val = predict(prev_val, prev_prev_val);
+        // padding repeats the previous residual to extend the current run
+        if (pixel_loc.y < image.rows && pixel_loc.x < image.cols)
+            residual = locPixel(image, pixel_loc, frame_index) - predicted_val;
+        val = predicted_val + residual;
+        _curve_residuals[num_residuals++] = residual;
+        prev_prev_val = prev_val;
+        prev_val = val;
+    }
+    // runs of equal residuals, split at UINT16_MAX
+    RunLengthKernel runLength = selectRunLengthKernel();
+    for (std::size_t pos = 0; pos < num_residuals;)
+    {
+        std::size_t frequency = runLength(&_curve_residuals[pos], std::min<std::size_t>(num_residuals - pos, UINT16_MAX));
+        residual_blocks.push_back({frequency, _curve_residuals[pos]});
+        pos += frequency;
+    }
+    // update number of bytes
+    setNumBytes(frame_index, _RESIDUAL_BLOCK_SIZE * residual_blocks.size());
+}
+
+void PredictiveEncoding::writeFrame(cv::Mat& image, std::size_t frame_index)
+{
+    _mapping->preprocess(getPaddedHeight(), getPaddedWidth());
+    uchar prev_val = 0, prev_prev_val = 0, val;
+    cv::Point cur_pt;
+    for (_ResidualBlock block : _residual_block_arrays[frame_index])
+    {
+        for (std::size_t i = 0; i < block.frequency; i++)
+        {
+            // padding is reconstructed as well, it is needed for the following predictions
+            val = predict(prev_val, prev_prev_val) + block.residual;
+            prev_prev_val = prev_val;
+            prev_val = val;
+            cur_pt = _mapping->next();
+            if (cur_pt.y >= image.rows || cur_pt.x >= image.cols)
+                continue;
+            locPixel(image, cur_pt, frame_index) = val;
+        }
+    }
+}
+
+void PredictiveEncoding::encodeFrame(uchar* buffer, std::size_t frame_index, std::size_t begin, std::size_t end)
+{
+    std::size_t cur_pos = begin;
+    for (_ResidualBlock block : _residual_block_arrays[frame_index])
+    {
+        assert(cur_pos < end);
+        locHWord(buffer, cur_pos) = (uint16_t) block.frequency;
+        locByte(buffer, cur_pos + 2) = block.residual;
+        cur_pos += _RESIDUAL_BLOCK_SIZE;
+    }
+}
+
+bool PredictiveEncoding::decodeFrame(uchar* buffer, std::size_t frame_index, std::size_t begin, std::size_t end)
+{
+    _residual_block_arrays[frame_index].clear();
+    if ((end - begin) % _RESIDUAL_BLOCK_SIZE != 0)
+        return false;
+    std::size_t num_points = 0;
+    for (std::size_t cur_pos = begin; cur_pos < end; cur_pos += _RESIDUAL_BLOCK_SIZE)
+    {
+        _residual_block_arrays[frame_index].push_back(
+            {locHWord(buffer, cur_pos), locByte(buffer, cur_pos + 2)}
+        );
+        num_points += locHWord(buffer, cur_pos);
+    }
+    // writeFrame expands the blocks along the whole curve, no more and no less
+    return num_points == getPaddedHeight() * getPaddedWidth();
+}
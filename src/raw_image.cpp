@@ -0,0 +1,41 @@
+#include "include/raw_image.h"
+
+RawImageReader::RawImageReader(std::istream& file, std::size_t height, std::size_t width, std::size_t num_channels)
+: _file(file), _height(height), _width(width), _num_channels(num_channels)
+{
+
+}
+
+bool RawImageReader::readRegion(const cv::Rect& roi, cv::Mat& region)
+{
+    assert(roi.x >= 0 && roi.y >= 0);
+    assert((std::size_t) (roi.x + roi.width) <= _width && (std::size_t) (roi.y + roi.height) <= _height);
+    region.create(roi.height, roi.width, CV_8UC((int)_num_channels));
+    std::size_t row_bytes = roi.width * _num_channels;
+    for (int y = 0; y < roi.height; y++)
+    {
+        _file.seekg(((roi.y + y) * _width + roi.x) * _num_channels);
+        _file.read((char*) region.ptr<uchar>(y), row_bytes);
+        if (!_file)
+            return false;
+    }
+    return true;
+}
+
+RawImageWriter::RawImageWriter(std::ostream& file, std::size_t height, std::size_t width, std::size_t num_channels)
+: _file(file), _height(height), _width(width), _num_channels(num_channels)
+{
+
+}
+
+void RawImageWriter::writeRegion(const cv::Point& origin, const cv::Mat& region)
+{
+    assert(region.depth() == CV_8U && (std::size_t) region.channels() == _num_channels);
+    assert((std::size_t) (origin.x + region.cols) <= _width && (std::size_t) (origin.y + region.rows) <= _height);
+    std::size_t row_bytes = region.cols * _num_channels;
+    for (int y = 0; y < region.rows; y++)
+    {
+        _file.seekp(((origin.y + y) * _width + origin.x) * _num_channels);
+        _file.write((const char*) region.ptr<uchar>(y), row_bytes);
+    }
+}
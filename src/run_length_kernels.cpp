@@ -0,0 +1,165 @@
+#include "include/image_compression/run_length_kernels.h"
+#include <random>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RUN_LENGTH_X86
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define RUN_LENGTH_NEON
+#endif
+
+std::size_t runLengthScalar(const uchar* values, std::size_t max_length)
+{
+    std::size_t length = 1;
+    while (length < max_length && values[length] == values[0])
+        length++;
+    return length;
+}
+
+#ifdef RUN_LENGTH_X86
+static std::size_t runLengthSSE2(const uchar* values, std::size_t max_length)
+{
+    const __m128i run_value = _mm_set1_epi8(values[0]);
+    std::size_t length = 0;
+    for (; length + 16 <= max_length; length += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*) &values[length]);
+        unsigned mismatch = ~_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, run_value)) & 0xFFFFu;
+        if (mismatch)
+            return length + __builtin_ctz(mismatch);
+    }
+    for (; length < max_length; length++)
+        if (values[length] != values[0])
+            return length;
+    return max_length;
+}
+
+__attribute__((target("avx2")))
+static std::size_t runLengthAVX2(const uchar* values, std::size_t max_length)
+{
+    const __m256i run_value = _mm256_set1_epi8(values[0]);
+    std::size_t length = 0;
+    for (; length + 32 <= max_length; length += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*) &values[length]);
+        unsigned mismatch = ~(unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, run_value));
+        if (mismatch)
+            return length + __builtin_ctz(mismatch);
+    }
+    for (; length < max_length; length++)
+        if (values[length] != values[0])
+            return length;
+    return max_length;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static std::size_t runLengthAVX512(const uchar* values, std::size_t max_length)
+{
+    const __m512i run_value = _mm512_set1_epi8(values[0]);
+    std::size_t length = 0;
+    for (; length + 64 <= max_length; length += 64)
+    {
+        __m512i chunk = _mm512_loadu_si512((const void*) &values[length]);
+        __mmask64 mismatch = _mm512_cmpneq_epi8_mask(chunk, run_value);
+        if (mismatch)
+            return length + __builtin_ctzll(mismatch);
+    }
+    for (; length < max_length; length++)
+        if (values[length] != values[0])
+            return length;
+    return max_length;
+}
+#endif // RUN_LENGTH_X86
+
+#ifdef RUN_LENGTH_NEON
+static std::size_t runLengthNEON(const uchar* values, std::size_t max_length)
+{
+    const uint8x16_t run_value = vdupq_n_u8(values[0]);
+    std::size_t length = 0;
+    for (; length + 16 <= max_length; length += 16)
+    {
+        uint8x16_t equal = vceqq_u8(vld1q_u8(&values[length]), run_value);
+        // narrow the comparison to 4 bits per value
+        uint64_t mismatch = ~vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(equal), 4)), 0);
+        if (mismatch)
+            return length + (__builtin_ctzll(mismatch) >> 2);
+    }
+    for (; length < max_length; length++)
+        if (values[length] != values[0])
+            return length;
+    return max_length;
+}
+#endif // RUN_LENGTH_NEON
+
+struct _KernelChoice
+{
+    RunLengthKernel kernel;
+    const char* name;
+};
+
+static _KernelChoice chooseRunLengthKernel()
+{
+#ifdef RUN_LENGTH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw"))
+        return {runLengthAVX512, "AVX-512"};
+    if (__builtin_cpu_supports("avx2"))
+        return {runLengthAVX2, "AVX2"};
+    return {runLengthSSE2, "SSE2"};
+#elif defined(RUN_LENGTH_NEON)
+    return {runLengthNEON, "NEON"};
+#else
+    return {runLengthScalar, "scalar"};
+#endif
+}
+
+static _KernelChoice verifiedRunLengthKernel()
+{
+    _KernelChoice choice = chooseRunLengthKernel();
+    // fall back to the scalar kernel if the vector kernel disagrees with it
+    if (!checkRunLengthKernel(choice.kernel))
+        return {runLengthScalar, "scalar"};
+    return choice;
+}
+
+static const _KernelChoice& runLengthKernelChoice()
+{
+    static const _KernelChoice choice = verifiedRunLengthKernel();
+    return choice;
+}
+
+RunLengthKernel selectRunLengthKernel()
+{
+    return runLengthKernelChoice().kernel;
+}
+
+const char* runLengthKernelName()
+{
+    return runLengthKernelChoice().name;
+}
+
+bool checkRunLengthKernel(RunLengthKernel kernel)
+{
+    // runs of every length around the vector widths, split at every possible offset
+    std::vector<uchar> values;
+    std::default_random_engine rng;
+    std::uniform_int_distribution<int> random_value(0, 255);
+    uchar value = 0;
+    for (std::size_t run = 1; run <= 200; run++)
+    {
+        value += 1 + random_value(rng) % 255;
+        values.insert(values.end(), run, value);
+    }
+    for (std::size_t begin = 0; begin < values.size(); begin++)
+    {
+        for (std::size_t max_length : {std::size_t(1), std::size_t(17), std::size_t(70), values.size() - begin})
+        {
+            max_length = std::min(max_length, values.size() - begin);
+            if (kernel(&values[begin], max_length) != runLengthScalar(&values[begin], max_length))
+                return false;
+        }
+    }
+    return true;
+}
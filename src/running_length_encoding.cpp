@@ -3,6 +3,15 @@
 
 const std::size_t RunningLengthEncoding::_PIXEL_BLOCK_SIZE = 3;
 
+// smallest difference between two distinct 8-bit pixel values after conversion to float32
+static float minPixelStep()
+{
+    float min_step = 1.0f;
+    for (int val = 0; val < 255; val++)
+        min_step = std::min(min_step, std::fabs(toFloatPixel(val + 1) - toFloatPixel(val)));
+    return min_step;
+}
+
 RunningLengthEncoding::RunningLengthEncoding(BaseLinearMapping* mapping, float threshold)
 : BaseImageCompression(true), _mapping(mapping), _threshold(threshold)
 {
@@ -16,13 +25,14 @@ RunningLengthEncoding::~RunningLengthEncoding()
 
 void RunningLengthEncoding::read(cv::Mat& image)
 {
-    int required_padding = 1;
-    while (required_padding < std::max(image.cols, image.rows))
-        required_padding <<= 1;
-    setPaddedHeight(required_padding);
-    setPaddedWidth(required_padding);
+    setPaddedSize(*_mapping, image.rows, image.cols);
     for (int i = 0; i < MAX_NUM_CHANNELS; i++)
         _pixel_block_arrays[i].clear();
+    // levels beyond a 1x1 thumbnail are useless
+    std::size_t max_levels = 0;
+    while ((1 << max_levels) < std::max(image.cols, image.rows))
+        max_levels++;
+    allocatePyramid(std::min(_pyramid_levels, max_levels), image.rows, image.cols, image.channels());
     BaseImageCompression::read(image);
 }
 
@@ -36,23 +46,34 @@ void RunningLengthEncoding::info() const
     BaseImageCompression::info();
 }
 
-void RunningLengthEncoding::readFrame(cv::Mat& frame, std::size_t frame_index)
+void RunningLengthEncoding::readFrame(const cv::Mat& image, std::size_t frame_index)
 {
+    if (!_pyramid.empty())
+        recordPyramid(image, frame_index);
     _mapping->preprocess(getPaddedHeight(), getPaddedWidth());
+    // any two distinct values start a new block, so the running mean never changes within a block
+    static const float min_pixel_step = minPixelStep();
+    if (_threshold > 0.0f && _threshold <= min_pixel_step)
+    {
+        readFrameLossless(image, frame_index);
+        return;
+    }
     float val;
     std::vector<_PixelBlock>& pixel_blocks = _pixel_block_arrays[frame_index];
     // Process first block
-    pixel_blocks.push_back({1, frame.at<float>(_mapping->next())});
+    pixel_blocks.push_back({1, toFloatPixel(locPixel(image, _mapping->next(), frame_index))});
     float prev_val = pixel_blocks.back().value;
     assert(prev_val >= 0.);
     // Process the rest
     for (cv::Point pixel_loc = _mapping->next(); pixel_loc != POINT_END; pixel_loc = _mapping->next())
     {
         // MAKE SURE FIRST PIXEL IS NON-EMPTY
-        val = frame.at<float>(pixel_loc);
-        // std::cout << val << " " << pixel_loc << std::endl;
-        if (val < 0.0f)
+        // padding takes the value of the previous pixel
+        if (pixel_loc.y >= image.rows || pixel_loc.x >= image.cols)
             val = prev_val;
+        else
+            val = toFloatPixel(locPixel(image, pixel_loc, frame_index));
+        // std::cout << val << " " << pixel_loc << std::endl;
         if (
             (std::fabs(val - prev_val) >= _threshold) || (pixel_blocks.back().frequency >= UINT16_MAX)
         )
@@ -76,11 +97,44 @@ void RunningLengthEncoding::readFrame(cv::Mat& frame, std::size_t frame_index)
     setNumBytes(frame_index, _PIXEL_BLOCK_SIZE * pixel_blocks.size());
 }
 
-void RunningLengthEncoding::writeFrame(cv::Mat& frame, std::size_t frame_index)
+void RunningLengthEncoding::readFrameLossless(const cv::Mat& image, std::size_t frame_index)
+{
+    std::vector<_PixelBlock>& pixel_blocks = _pixel_block_arrays[frame_index];
+    // gather channel in curve order, padding takes the value of the previous pixel
+    _curve_values.resize(getPaddedHeight() * getPaddedWidth());
+    std::size_t num_values = 0;
+    for (cv::Point pixel_loc = _mapping->next(); pixel_loc != POINT_END; pixel_loc = _mapping->next())
+    {
+        // MAKE SURE FIRST PIXEL IS NON-EMPTY
+        if (pixel_loc.y >= image.rows || pixel_loc.x >= image.cols)
+            _curve_values[num_values] = _curve_values[num_values - 1];
+        else
+            _curve_values[num_values] = locPixel(image, pixel_loc, frame_index);
+        num_values++;
+    }
+    // find run boundaries, runs are split at UINT16_MAX like in readFrame
+    RunLengthKernel runLength = selectRunLengthKernel();
+    for (std::size_t pos = 0; pos < num_values;)
+    {
+        std::size_t frequency = runLength(&_curve_values[pos], std::min<std::size_t>(num_values - pos, UINT16_MAX));
+        pixel_blocks.push_back({frequency, toFloatPixel(_curve_values[pos])});
+        pos += frequency;
+    }
+    // update number of bytes
+    setNumBytes(frame_index, _PIXEL_BLOCK_SIZE * pixel_blocks.size());
+}
+
+void RunningLengthEncoding::writeFrame(cv::Mat& image, std::size_t frame_index)
 {
-    auto randomPixel = std::bind(std::uniform_real_distribution<float>(0.0f, 1.0f), std::default_random_engine());
-    float randomized_color;
+    auto randomPixel = std::bind(std::uniform_int_distribution<int>(0, 255), std::default_random_engine());
+    uchar randomized_color;
     _mapping->preprocess(getPaddedHeight(), getPaddedWidth());
+    // random colors must be drawn in block order
+    if (!_random_colors && _num_threads > 1)
+    {
+        writeFrameParallel(image, frame_index);
+        return;
+    }
     std::vector<_PixelBlock>& pixel_blocks = _pixel_block_arrays[frame_index];
     //pixel_loc != POINT_END
     cv::Point cur_pt;
@@ -93,10 +147,9 @@ void RunningLengthEncoding::writeFrame(cv::Mat& frame, std::size_t frame_index)
             {
                 cur_pt = _mapping->next();
                 // std::cout << cur_pt << std::endl;
-                if (cur_pt.y >= frame.rows || cur_pt.x >= frame.cols)
+                if (cur_pt.y >= image.rows || cur_pt.x >= image.cols)
                     continue;
-                frame.at<float>(cur_pt) = randomized_color;
-                // std::cout << frame.at<float>(cur_pt) << std::endl;
+                locPixel(image, cur_pt, frame_index) = randomized_color;
             }
         }
     }
@@ -104,19 +157,56 @@ void RunningLengthEncoding::writeFrame(cv::Mat& frame, std::size_t frame_index)
     {
         for (_PixelBlock block : pixel_blocks)
         {
+            uchar value = toBytePixel(block.value);
             for (int i = 0; i < block.frequency; i++)
             {
                 cur_pt = _mapping->next();
                 // std::cout << cur_pt << std::endl;
-                if (cur_pt.y >= frame.rows || cur_pt.x >= frame.cols)
+                if (cur_pt.y >= image.rows || cur_pt.x >= image.cols)
                     continue;
-                frame.at<float>(cur_pt) = block.value;
-                // std::cout << frame.at<float>(cur_pt) << std::endl;
+                locPixel(image, cur_pt, frame_index) = value;
             }
         }
     }
 }
 
+void RunningLengthEncoding::writeFrameParallel(cv::Mat& image, std::size_t frame_index)
+{
+    std::vector<_PixelBlock>& pixel_blocks = _pixel_block_arrays[frame_index];
+    // exclusive prefix sum of the block frequencies: index of the first curve point of every block
+    std::vector<std::size_t> block_begins(pixel_blocks.size() + 1, 0);
+    for (std::size_t i = 0; i < pixel_blocks.size(); i++)
+        block_begins[i + 1] = block_begins[i] + pixel_blocks[i].frequency;
+    const std::size_t num_points = std::min(block_begins.back(), _mapping->size());
+
+    auto expandSlice = [&](std::size_t slice_begin, std::size_t slice_end)
+    {
+        // find the block containing slice_begin
+        std::size_t block_index = std::upper_bound(block_begins.begin(), block_begins.end(), slice_begin)
+            - block_begins.begin() - 1;
+        for (std::size_t pos = slice_begin; pos < slice_end; block_index++)
+        {
+            std::size_t block_end = std::min(block_begins[block_index + 1], slice_end);
+            uchar value = toBytePixel(pixel_blocks[block_index].value);
+            for (; pos < block_end; pos++)
+            {
+                cv::Point cur_pt = _mapping->at(pos);
+                if (cur_pt.y >= image.rows || cur_pt.x >= image.cols)
+                    continue;
+                locPixel(image, cur_pt, frame_index) = value;
+            }
+        }
+    };
+
+    // split the curve evenly, slices write to disjoint pixels
+    std::vector<std::thread> threads;
+    for (std::size_t t = 1; t < _num_threads; t++)
+        threads.emplace_back(expandSlice, num_points * t / _num_threads, num_points * (t + 1) / _num_threads);
+    expandSlice(0, num_points / _num_threads);
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
 void RunningLengthEncoding::visualiseEncoding(cv::Mat& image, bool show_padding)
 {
     _random_colors = true;
@@ -129,9 +219,157 @@ void RunningLengthEncoding::encode(std::ostream& file)
     BaseImageCompression::encode(file);
 }
 
-void RunningLengthEncoding::decode(std::istream& file)
+bool RunningLengthEncoding::decode(std::istream& file)
+{
+    _pyramid.clear();
+    return BaseImageCompression::decode(file);
+}
+
+void RunningLengthEncoding::allocatePyramid(
+    std::size_t levels, std::size_t height, std::size_t width, std::size_t num_channels
+)
+{
+    _pyramid.resize(levels);
+    for (std::size_t level = 1; level <= levels; level++)
+    {
+        std::size_t scale = (std::size_t) 1 << level;
+        _pyramid[level - 1].create(
+            (height + scale - 1) / scale,
+            (width + scale - 1) / scale,
+            CV_8UC((int)num_channels)
+        );
+    }
+}
+
+void RunningLengthEncoding::recordPyramid(const cv::Mat& image, std::size_t frame_index)
+{
+    // sums and pixel counts of the cells of the current level, starting with level 1
+    std::size_t height = (image.rows + 1) / 2, width = (image.cols + 1) / 2;
+    std::vector<uint64_t> sums(height * width, 0), counts(height * width, 0);
+    for (int y = 0; y < image.rows; y++)
+    {
+        for (int x = 0; x < image.cols; x++)
+        {
+            std::size_t cell = (y >> 1) * width + (x >> 1);
+            sums[cell] += locPixel(image, cv::Point(x, y), frame_index);
+            counts[cell]++;
+        }
+    }
+    for (std::size_t level = 1; level <= _pyramid.size(); level++)
+    {
+        cv::Mat& level_image = _pyramid[level - 1];
+        assert((std::size_t) level_image.rows == height && (std::size_t) level_image.cols == width);
+        for (std::size_t y = 0; y < height; y++)
+            for (std::size_t x = 0; x < width; x++)
+                locPixel(level_image, cv::Point(x, y), frame_index)
+                    = (sums[y * width + x] + counts[y * width + x] / 2) / counts[y * width + x];
+        if (level == _pyramid.size())
+            break;
+        // merge 2x2 cells into the cells of the next level
+        std::size_t next_height = (height + 1) / 2, next_width = (width + 1) / 2;
+        std::vector<uint64_t> next_sums(next_height * next_width, 0), next_counts(next_height * next_width, 0);
+        for (std::size_t y = 0; y < height; y++)
+        {
+            for (std::size_t x = 0; x < width; x++)
+            {
+                next_sums[(y >> 1) * next_width + (x >> 1)] += sums[y * width + x];
+                next_counts[(y >> 1) * next_width + (x >> 1)] += counts[y * width + x];
+            }
+        }
+        height = next_height;
+        width = next_width;
+        sums.swap(next_sums);
+        counts.swap(next_counts);
+    }
+}
+
+bool RunningLengthEncoding::preview(std::size_t level, cv::Mat& thumbnail) const
 {
-    BaseImageCompression::decode(file);
+    if (level < 1 || level > _pyramid.size())
+    {
+        thumbnail.release();
+        return false;
+    }
+    _pyramid[level - 1].copyTo(thumbnail);
+    return true;
+}
+
+bool RunningLengthEncoding::decodePreview(std::istream& file, std::size_t level, cv::Mat& thumbnail)
+{
+    _pyramid.clear();
+    if (!decodeAuxiliarySection(file))
+    {
+        _pyramid.clear();
+        thumbnail.release();
+        return false;
+    }
+    return preview(level, thumbnail);
+}
+
+std::size_t RunningLengthEncoding::getAuxiliaryBytes() const
+{
+    if (_pyramid.empty())
+        return 0;
+    std::size_t num_bytes = sizeof(uint64_t);
+    for (const cv::Mat& level_image : _pyramid)
+        num_bytes += level_image.total() * level_image.elemSize();
+    return num_bytes;
+}
+
+void RunningLengthEncoding::encodeAuxiliary(uchar* buffer, std::size_t begin, std::size_t end)
+{
+    //
+    // Preview pyramid:
+    //  (unsigned long) levels
+    //  (uchar []) interleaved pixels of every level (@per level, row by row)
+    //
+    std::size_t cur_pos = begin;
+    locDWord(buffer, cur_pos) = _pyramid.size();
+    cur_pos += sizeof(uint64_t);
+    for (const cv::Mat& level_image : _pyramid)
+    {
+        std::size_t row_bytes = level_image.cols * level_image.elemSize();
+        for (int y = 0; y < level_image.rows; y++)
+        {
+            assert(cur_pos + row_bytes <= end);
+            std::memcpy(&buffer[cur_pos], level_image.ptr<uchar>(y), row_bytes);
+            cur_pos += row_bytes;
+        }
+    }
+}
+
+bool RunningLengthEncoding::decodeAuxiliary(uchar* buffer, std::size_t begin, std::size_t end)
+{
+    std::size_t cur_pos = begin;
+    if (end - begin < sizeof(uint64_t))
+        return false;
+    std::size_t levels = locDWord(buffer, cur_pos);
+    cur_pos += sizeof(uint64_t);
+    // the levels must fill the section exactly, checked before anything is allocated
+    std::size_t max_levels = 0;
+    while (((std::size_t) 1 << max_levels) < std::max(getHeight(), getWidth()))
+        max_levels++;
+    if (levels > max_levels)
+        return false;
+    std::size_t level_bytes = 0;
+    for (std::size_t level = 1; level <= levels; level++)
+    {
+        std::size_t scale = (std::size_t) 1 << level;
+        level_bytes += ((getHeight() + scale - 1) / scale) * ((getWidth() + scale - 1) / scale) * getNumChannels();
+    }
+    if (level_bytes != end - cur_pos)
+        return false;
+    allocatePyramid(levels, getHeight(), getWidth(), getNumChannels());
+    for (cv::Mat& level_image : _pyramid)
+    {
+        std::size_t row_bytes = level_image.cols * level_image.elemSize();
+        for (int y = 0; y < level_image.rows; y++)
+        {
+            std::memcpy(level_image.ptr<uchar>(y), &buffer[cur_pos], row_bytes);
+            cur_pos += row_bytes;
+        }
+    }
+    return true;
 }
 
 void RunningLengthEncoding::encodeFrame(uchar* buffer, std::size_t frame_index, std::size_t begin, std::size_t end)
@@ -153,14 +391,19 @@ void RunningLengthEncoding::encodeFrame(uchar* buffer, std::size_t frame_index,
     // assert(false);
 }
 
-void RunningLengthEncoding::decodeFrame(uchar* buffer, std::size_t frame_index, std::size_t begin, std::size_t end)
+bool RunningLengthEncoding::decodeFrame(uchar* buffer, std::size_t frame_index, std::size_t begin, std::size_t end)
 {
     _pixel_block_arrays[frame_index].clear();
+    if ((end - begin) % _PIXEL_BLOCK_SIZE != 0)
+        return false;
+    std::size_t num_points = 0;
     for (std::size_t cur_pos = begin; cur_pos < end; cur_pos += _PIXEL_BLOCK_SIZE)
     {
         _pixel_block_arrays[frame_index].push_back(
             {locHWord(buffer, cur_pos), (float) locByte(buffer, cur_pos + 2) / 255.0f}
         );
+        num_points += locHWord(buffer, cur_pos);
     }
+    // writeFrame expands the blocks along the whole curve, no more and no less
+    return num_points == getPaddedHeight() * getPaddedWidth();
 }
-
@@ -0,0 +1,215 @@
+#include "include/image_compression/running_length_transform.h"
+#include <climits>
+#include "include/linear_mapping/hilbert_curve.h"
+#include "include/linear_mapping/morton_curve.h"
+
+// must match BaseImageCompression and RunningLengthEncoding
+const std::size_t RunningLengthTransform::_METADATA_SIZE = 128;
+const std::size_t RunningLengthTransform::_PIXEL_BLOCK_SIZE = 3;
+
+bool RunningLengthTransform::load(std::istream& file)
+{
+    std::size_t remaining_bytes = BaseImageCompression::remainingBytes(file);
+    //
+    // Read metadata (see BaseImageCompression::encode)
+    //  (unsigned long) num_channels
+    //  (unsigned long) height
+    //  (unsigned long) width
+    //  (bool) padding
+    //  (unsigned long) padded_height
+    //  (unsigned long) padded_width
+    //  (unsigned long []) num_bytes (@per frame) [warning: variable length]
+    //  (unsigned long) auxiliary_bytes (after num_bytes of MAX_NUM_CHANNELS frames)
+    //
+    uchar metadata[_METADATA_SIZE];
+    file.read((char*) metadata, _METADATA_SIZE);
+    for (std::size_t i = 0; i < MAX_NUM_CHANNELS; i++)
+        _frames[i].clear();
+    _num_channels = 0;
+    if ((std::size_t) file.gcount() != _METADATA_SIZE)
+        return false;
+    std::size_t num_channels = locDWord(metadata, (0 << 3));
+    _height = locDWord(metadata, (1 << 3));
+    _width = locDWord(metadata, (2 << 3));
+    _padding = locDWord(metadata, (3 << 3));
+    _padded_height = locDWord(metadata, (4 << 3));
+    _padded_width = locDWord(metadata, (5 << 3));
+    // the padded image must cover the image, and its number of pixels must not overflow
+    if (num_channels == 0 || num_channels > MAX_NUM_CHANNELS
+        || _height == 0 || _height > _padded_height || _padded_height > INT_MAX
+        || _width == 0 || _width > _padded_width || _padded_width > INT_MAX)
+        return false;
+    // frames are kept as encoded, the auxiliary section is not read
+    remaining_bytes -= std::min(remaining_bytes, _METADATA_SIZE);
+    for (std::size_t i = 0; i < num_channels; i++)
+    {
+        std::size_t num_bytes = locDWord(metadata, ((i + 6) << 3));
+        if (num_bytes % _PIXEL_BLOCK_SIZE != 0 || num_bytes > remaining_bytes)
+            return false;
+        remaining_bytes -= num_bytes;
+        _frames[i].resize(num_bytes);
+        file.read((char*) _frames[i].data(), num_bytes);
+        if ((std::size_t) file.gcount() != num_bytes)
+            return false;
+        // the transforms walk the blocks along the whole curve, no more and no less
+        std::size_t num_points = 0;
+        for (std::size_t read_pos = 0; read_pos < num_bytes; read_pos += _PIXEL_BLOCK_SIZE)
+            num_points += locHWord(_frames[i], read_pos);
+        if (num_points != _padded_height * _padded_width)
+            return false;
+    }
+    _num_channels = num_channels;
+    return true;
+}
+
+void RunningLengthTransform::save(std::ostream& file) const
+{
+    uchar metadata[_METADATA_SIZE];
+    std::memset(metadata, 0, _METADATA_SIZE);
+    locDWord(metadata, (0 << 3)) = _num_channels;
+    locDWord(metadata, (1 << 3)) = _height;
+    locDWord(metadata, (2 << 3)) = _width;
+    locDWord(metadata, (3 << 3)) = (std::size_t) _padding;
+    locDWord(metadata, (4 << 3)) = _padded_height;
+    locDWord(metadata, (5 << 3)) = _padded_width;
+    for (std::size_t i = 0; i < _num_channels; i++)
+        locDWord(metadata, ((i + 6) << 3)) = _frames[i].size();
+    file.write((char*) metadata, _METADATA_SIZE);
+    for (std::size_t i = 0; i < _num_channels; i++)
+        file.write((const char*) _frames[i].data(), _frames[i].size());
+}
+
+void RunningLengthTransform::extractChannel(std::size_t channel)
+{
+    assert(channel < _num_channels);
+    // a frame is a contiguous byte range, no block has to be parsed
+    if (channel != 0)
+        _frames[0].swap(_frames[channel]);
+    for (std::size_t i = 1; i < MAX_NUM_CHANNELS; i++)
+        _frames[i].clear();
+    _num_channels = 1;
+}
+
+void RunningLengthTransform::requantize(float threshold)
+{
+    const float byte_threshold = threshold * 255.f;
+    for (std::size_t i = 0; i < _num_channels; i++)
+    {
+        std::vector<uchar>& frame = _frames[i];
+        if (frame.empty())
+            continue;
+        // merge in place, the running mean of the merged block is weighted by the block frequencies
+        std::size_t write_pos = 0;
+        std::size_t frequency = locHWord(frame, 0);
+        float value = locByte(frame, 2);
+        for (std::size_t read_pos = _PIXEL_BLOCK_SIZE; read_pos < frame.size(); read_pos += _PIXEL_BLOCK_SIZE)
+        {
+            std::size_t next_frequency = locHWord(frame, read_pos);
+            float next_value = locByte(frame, read_pos + 2);
+            if (std::fabs(next_value - value) < byte_threshold && frequency + next_frequency <= UINT16_MAX)
+            {
+                value += (next_value - value) * next_frequency / (frequency + next_frequency);
+                frequency += next_frequency;
+                continue;
+            }
+            locHWord(frame, write_pos) = (uint16_t) frequency;
+            locByte(frame, write_pos + 2) = cv::saturate_cast<uchar>(value);
+            write_pos += _PIXEL_BLOCK_SIZE;
+            frequency = next_frequency;
+            value = next_value;
+        }
+        locHWord(frame, write_pos) = (uint16_t) frequency;
+        locByte(frame, write_pos + 2) = cv::saturate_cast<uchar>(value);
+        frame.resize(write_pos + _PIXEL_BLOCK_SIZE);
+    }
+}
+
+bool RunningLengthTransform::cropQuadrant(const BaseLinearMapping& mapping, int quadrant)
+{
+    if (quadrant < 0 || quadrant > 3 || _padded_height != _padded_width || _padded_height < 2)
+        return false;
+    // position of the quadrant along the curve, its sub-curve must have the shape of the whole curve
+    std::size_t span;
+    if (typeid(mapping) == typeid(MortonCurve))
+        span = quadrant;
+    else if (typeid(mapping) == typeid(HilbertCurve) && (quadrant == 2 || quadrant == 3))
+        span = quadrant - 1;
+    else
+        return false;
+
+    std::size_t half = _padded_height / 2;
+    std::size_t top = (quadrant >> 1) * half;
+    std::size_t left = (quadrant & 1) * half;
+    if (_height <= top || _width <= left)
+        return false;  // nothing but padding
+    // the decoder pads the cropped image again, which must give back the quadrant
+    const std::size_t cropped_height = std::min(_height - top, half);
+    const std::size_t cropped_width = std::min(_width - left, half);
+    cv::Size padded_size = mapping.getPaddedSize(cropped_height, cropped_width);
+    if ((std::size_t) padded_size.height != half || (std::size_t) padded_size.width != half)
+        return false;
+
+    const std::size_t range_begin = span * half * half;
+    const std::size_t range_end = range_begin + half * half;
+    for (std::size_t i = 0; i < _num_channels; i++)
+    {
+        std::vector<uchar>& frame = _frames[i];
+        std::vector<uchar> cropped;
+        std::size_t block_begin = 0;
+        for (std::size_t read_pos = 0; read_pos < frame.size() && block_begin < range_end; read_pos += _PIXEL_BLOCK_SIZE)
+        {
+            std::size_t block_end = block_begin + locHWord(frame, read_pos);
+            // keep the part of the block within the curve range
+            std::size_t overlap_begin = std::max(block_begin, range_begin);
+            std::size_t overlap_end = std::min(block_end, range_end);
+            if (overlap_begin < overlap_end)
+            {
+                cropped.resize(cropped.size() + _PIXEL_BLOCK_SIZE);
+                locHWord(cropped, cropped.size() - _PIXEL_BLOCK_SIZE) = (uint16_t) (overlap_end - overlap_begin);
+                locByte(cropped, cropped.size() - 1) = locByte(frame, read_pos + 2);
+            }
+            block_begin = block_end;
+        }
+        frame.swap(cropped);
+    }
+    _height = cropped_height;
+    _width = cropped_width;
+    _padded_height = half;
+    _padded_width = half;
+    return true;
+}
+
+bool RunningLengthTransform::flipHorizontal(const BaseLinearMapping& mapping)
+{
+    // the reversed Hilbert curve is the mirrored curve, padded columns would be mirrored into the image
+    if (typeid(mapping) != typeid(HilbertCurve) || _width != _padded_width)
+        return false;
+    reverseBlocks();
+    return true;
+}
+
+bool RunningLengthTransform::rotate180(const BaseLinearMapping& mapping)
+{
+    // the reversed Morton curve is the rotated curve, padding would be rotated into the image
+    if (typeid(mapping) != typeid(MortonCurve) || _width != _padded_width || _height != _padded_height)
+        return false;
+    reverseBlocks();
+    return true;
+}
+
+void RunningLengthTransform::reverseBlocks()
+{
+    for (std::size_t i = 0; i < _num_channels; i++)
+    {
+        std::vector<uchar>& frame = _frames[i];
+        std::size_t num_blocks = frame.size() / _PIXEL_BLOCK_SIZE;
+        for (std::size_t j = 0; j < num_blocks / 2; j++)
+        {
+            std::swap_ranges(
+                frame.begin() + j * _PIXEL_BLOCK_SIZE,
+                frame.begin() + (j + 1) * _PIXEL_BLOCK_SIZE,
+                frame.begin() + (num_blocks - 1 - j) * _PIXEL_BLOCK_SIZE
+            );
+        }
+    }
+}
@@ -0,0 +1,180 @@
+#include "include/image_compression/tiled_compression.h"
+#include <climits>
+
+const std::size_t TiledCompression::_METADATA_SIZE = 128;
+
+TiledCompression::TiledCompression(BaseImageCompression* compressor, std::size_t tile_size)
+: _compressor(compressor), _tile_size(tile_size)
+{
+    // tiles must be aligned to the linear mappings
+    assert(tile_size > 0 && (tile_size & (tile_size - 1)) == 0);
+    assert(tile_size <= MAX_TILE_SIZE);
+}
+
+TiledCompression::~TiledCompression()
+{
+    delete _compressor;
+}
+
+bool TiledCompression::compress(RawImageReader& reader, std::ostream& file)
+{
+    std::cout << " -------------------- Tiled compression begins -------------------- \n";
+    Timer timer;
+    timer.begin();
+    _num_channels = reader.getNumChannels();
+    _height = reader.getHeight();
+    _width = reader.getWidth();
+    _tile_index.clear();
+    //
+    // Write metadata (preserve 128B, 8B to store each var):
+    //  (unsigned long) num_channels
+    //  (unsigned long) height
+    //  (unsigned long) width
+    //  (unsigned long) tile_size
+    //
+    uchar metadata[_METADATA_SIZE];
+    std::memset(metadata, 0, _METADATA_SIZE);
+    locDWord(metadata, (0 << 3)) = getNumChannels();
+    locDWord(metadata, (1 << 3)) = getHeight();
+    locDWord(metadata, (2 << 3)) = getWidth();
+    locDWord(metadata, (3 << 3)) = getTileSize();
+    file.write((char*) metadata, _METADATA_SIZE);
+    std::size_t write_pos = _METADATA_SIZE;
+
+    // only a single tile and its compressed stream are held in memory at any time
+    cv::Mat tile;
+    for (std::size_t tile_y = 0; tile_y < getNumTilesY(); tile_y++)
+    {
+        for (std::size_t tile_x = 0; tile_x < getNumTilesX(); tile_x++)
+        {
+            std::cout << "\tTile (" << tile_y << ", " << tile_x << ")\n";
+            cv::Rect roi(
+                tile_x * _tile_size,
+                tile_y * _tile_size,
+                std::min(_tile_size, _width - tile_x * _tile_size),
+                std::min(_tile_size, _height - tile_y * _tile_size)
+            );
+            if (!reader.readRegion(roi, tile))
+                return false;
+            _compressor->read(tile);
+            std::ostringstream tile_stream;
+            _compressor->encode(tile_stream);
+            const std::string& tile_bytes = tile_stream.str();
+            file.write(tile_bytes.data(), tile_bytes.size());
+            _tile_index.push_back({write_pos, tile_bytes.size()});
+            write_pos += tile_bytes.size();
+        }
+    }
+
+    // append tile index and its offset
+    std::size_t index_offset = write_pos;
+    for (const _TileEntry& entry : _tile_index)
+    {
+        file.write((const char*) &entry.offset, sizeof(uint64_t));
+        file.write((const char*) &entry.size, sizeof(uint64_t));
+    }
+    file.write((const char*) &index_offset, sizeof(uint64_t));
+    timer.end();
+    timer.report();
+    std::cout << " -------------------- Tiled compression ends -------------------- \n";
+    return true;
+}
+
+bool TiledCompression::open(std::istream& file)
+{
+    _tile_index.clear();
+    file.seekg(0, std::ios::end);
+    std::streamoff file_size = file.tellg();
+    if (!file || file_size < (std::streamoff) (_METADATA_SIZE + sizeof(uint64_t)))
+        return false;
+    //
+    // Read metadata
+    //  (unsigned long) num_channels
+    //  (unsigned long) height
+    //  (unsigned long) width
+    //  (unsigned long) tile_size
+    //
+    uchar metadata[_METADATA_SIZE];
+    file.seekg(0);
+    file.read((char*) metadata, _METADATA_SIZE);
+    if ((std::size_t) file.gcount() != _METADATA_SIZE)
+        return false;
+    _num_channels = locDWord(metadata, (0 << 3));
+    _height = locDWord(metadata, (1 << 3));
+    _width = locDWord(metadata, (2 << 3));
+    _tile_size = locDWord(metadata, (3 << 3));
+    // regions are cv::Mat objects, so the dimensions must fit in an int
+    if (_num_channels == 0 || _num_channels > MAX_NUM_CHANNELS
+        || _height == 0 || _height > INT_MAX || _width == 0 || _width > INT_MAX
+        || _tile_size == 0 || (_tile_size & (_tile_size - 1)) || _tile_size > MAX_TILE_SIZE)
+        return false;
+
+    // the tile index must lie between the tile streams and the trailing index offset, with one entry per tile
+    uint64_t index_offset;
+    std::size_t index_end = file_size - sizeof(uint64_t);
+    file.seekg(index_end);
+    file.read((char*) &index_offset, sizeof(uint64_t));
+    if ((std::size_t) file.gcount() != sizeof(uint64_t) || index_offset < _METADATA_SIZE || index_offset > index_end)
+        return false;
+    std::size_t num_entries = (index_end - index_offset) / (2 * sizeof(uint64_t));
+    if ((index_end - index_offset) % (2 * sizeof(uint64_t)) != 0
+        || getNumTilesY() > num_entries / getNumTilesX() || getNumTilesY() * getNumTilesX() != num_entries)
+        return false;
+    file.seekg(index_offset);
+    _tile_index.resize(num_entries);
+    for (_TileEntry& entry : _tile_index)
+    {
+        uint64_t offset, size;
+        file.read((char*) &offset, sizeof(uint64_t));
+        file.read((char*) &size, sizeof(uint64_t));
+        entry = {offset, size};
+        if (!file || offset < _METADATA_SIZE || size > index_offset || offset > index_offset - size)
+        {
+            _tile_index.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TiledCompression::decodeTile(std::istream& file, std::size_t tile_y, std::size_t tile_x, cv::Mat& tile)
+{
+    assert(tile_y < getNumTilesY() && tile_x < getNumTilesX());
+    const _TileEntry& entry = _tile_index[tile_y * getNumTilesX() + tile_x];
+    // hand only this tile's stream to the compressor
+    std::string tile_bytes(entry.size, '\0');
+    file.seekg(entry.offset);
+    file.read(&tile_bytes[0], entry.size);
+    std::istringstream tile_stream(tile_bytes);
+    if (!file || !_compressor->decode(tile_stream))
+        return false;
+    _compressor->write(tile, false);
+    // every tile must cover its own region of the image
+    return (std::size_t) tile.rows == std::min(_tile_size, _height - tile_y * _tile_size)
+        && (std::size_t) tile.cols == std::min(_tile_size, _width - tile_x * _tile_size)
+        && (std::size_t) tile.channels() == _num_channels;
+}
+
+bool TiledCompression::decompress(std::istream& file, RawImageWriter& writer)
+{
+    std::cout << " -------------------- Tiled decompression begins -------------------- \n";
+    Timer timer;
+    timer.begin();
+    assert(writer.getHeight() == getHeight() && writer.getWidth() == getWidth());
+    assert(writer.getNumChannels() == getNumChannels());
+    cv::Mat tile;
+    for (std::size_t tile_y = 0; tile_y < getNumTilesY(); tile_y++)
+    {
+        for (std::size_t tile_x = 0; tile_x < getNumTilesX(); tile_x++)
+        {
+            std::cout << "\tTile (" << tile_y << ", " << tile_x << ")\n";
+            if (!decodeTile(file, tile_y, tile_x, tile))
+                return false;
+            writer.writeRegion(cv::Point(tile_x * _tile_size, tile_y * _tile_size), tile);
+        }
+    }
+    timer.end();
+    timer.report();
+    std::cout << " -------------------- Tiled decompression ends -------------------- \n";
+    return true;
+}
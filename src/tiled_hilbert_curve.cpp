@@ -0,0 +1,59 @@
+#include "include/linear_mapping/tiled_hilbert_curve.h"
+#include "include/linear_mapping/hilbert_curve.h"
+
+TiledHilbertCurve::TiledHilbertCurve(std::size_t tile_size)
+: BaseLinearMapping(), _tile_size(tile_size)
+{
+    assert(tile_size > 0 && (tile_size & (tile_size - 1)) == 0);
+    HilbertCurve tile_curve;
+    tile_curve.preprocess(tile_size, tile_size);
+    tile_points.reserve(tile_curve.size());
+    for (cv::Point pt = tile_curve.next(); pt != POINT_END; pt = tile_curve.next())
+        tile_points.push_back(pt);
+}
+
+cv::Point TiledHilbertCurve::next()
+{
+    if (cursor >= points.size())
+        return POINT_END;
+    return points[cursor++];
+}
+
+cv::Point TiledHilbertCurve::at(std::size_t index) const
+{
+    if (index >= points.size())
+        return POINT_END;
+    return points[index];
+}
+
+cv::Size TiledHilbertCurve::getPaddedSize(std::size_t height, std::size_t width) const
+{
+    return cv::Size(
+        (width + _tile_size - 1) / _tile_size * _tile_size,
+        (height + _tile_size - 1) / _tile_size * _tile_size
+    );
+}
+
+void TiledHilbertCurve::preprocess(std::size_t height, std::size_t width)
+{
+    // reuse the points of the previous call for the same size
+    cursor = 0;
+    if (height == _height && width == _width)
+        return;
+    _height = height;
+    _width = width;
+    points.clear();
+    points.reserve(height * width);
+    for (std::size_t tile_y = 0; tile_y < height; tile_y += _tile_size)
+    {
+        for (std::size_t tile_x = 0; tile_x < width; tile_x += _tile_size)
+        {
+            // points of partial tiles beyond the given size are skipped
+            for (const cv::Point& pt : tile_points)
+            {
+                if (tile_y + pt.y < height && tile_x + pt.x < width)
+                    points.push_back(cv::Point(tile_x + pt.x, tile_y + pt.y));
+            }
+        }
+    }
+}